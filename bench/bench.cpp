@@ -0,0 +1,218 @@
+/**
+ * parse throughput benchmark and regression gate
+ *
+ *     leptjson_bench [-repeat=N] [-scale=K] [-save=FILE] [-baseline=FILE] [-threshold=PCT]
+ *
+ * prints MB/s for every document and parse mode; -save writes the results as a baseline,
+ * -baseline fails (exit 1) when a result is more than PCT percent (default 10) below it
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "leptjson.h"
+
+using namespace leptjson;
+
+static unsigned long long bench_state = 0x2545F4914F6CDD1DULL;
+
+static unsigned bench_random(unsigned n) {
+    bench_state = bench_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned)(bench_state >> 33) % n;
+}
+
+/* deterministic documents, scale 1 is a few MB each */
+
+static std::string bench_numbers(int scale) {
+    std::string s = "[";
+    char buf[32];
+    for (int i = 0; i < 200000 * scale; i++) {
+        if (i > 0)
+            s += ',';
+        if (i % 2)
+            snprintf(buf, sizeof(buf), "%d", (int)bench_random(2000000) - 1000000);
+        else
+            snprintf(buf, sizeof(buf), "%.17g", bench_random(1000000) / 997.0 * (i % 3 ? 1e-5 : 1e5));
+        s += buf;
+    }
+    return s + "]";
+}
+
+static std::string bench_strings(int scale) {
+    static const char* const words[] = { "lorem", "ipsum", "caf\xC3\xA9", "\\n", "\\\"q\\\"", "\xE2\x82\xAC", "\\u00e9", "dolor" };
+    std::string s = "[";
+    for (int i = 0; i < 50000 * scale; i++) {
+        if (i > 0)
+            s += ',';
+        s += '"';
+        for (unsigned n = 2 + bench_random(12); n > 0; n--) {
+            s += words[bench_random(8)];
+            s += ' ';
+        }
+        s += '"';
+    }
+    return s + "]";
+}
+
+static std::string bench_records(int scale) {
+    std::string s = "[";
+    char buf[256];
+    for (int i = 0; i < 40000 * scale; i++) {
+        snprintf(buf, sizeof(buf), "%s{\"id\":%d,\"name\":\"user%u\",\"active\":%s,\"score\":%.3f,"
+            "\"tags\":[\"a\",\"b%u\"],\"geo\":{\"lat\":%.6f,\"lon\":%.6f},\"parent\":null}",
+            i > 0 ? "," : "", i, bench_random(100000), bench_random(2) ? "true" : "false",
+            bench_random(100000) / 7.0, bench_random(50), bench_random(180000) / 1000.0 - 90,
+            bench_random(360000) / 1000.0 - 180);
+        s += buf;
+    }
+    return s + "]";
+}
+
+typedef int (*bench_fn)(const std::string& json, lept_size_hints* hints);
+
+static int bench_parse(const std::string& json, lept_size_hints*) {
+    lept_value v;
+    int ret = v.lept_parse(json.c_str());
+    v.lept_free();
+    return ret;
+}
+
+static int bench_parse_strict(const std::string& json, lept_size_hints*) {
+    lept_value v;
+    int ret = v.lept_parse(json.c_str(), LEPT_PARSE_STRICT_UTF8);
+    v.lept_free();
+    return ret;
+}
+
+static int bench_parse_hints(const std::string& json, lept_size_hints* hints) {
+    lept_value v;
+    int ret = v.lept_parse(json.c_str(), LEPT_PARSE_DEFAULT, hints);
+    v.lept_free();
+    return ret;
+}
+
+static int bench_validate(const std::string& json, lept_size_hints*) {
+    return lept_validate(json.data(), json.size());
+}
+
+static int bench_stream(const std::string& json, lept_size_hints*) {
+    lept_value v;
+    lept_stream_parser p(&v);
+    int ret = LEPT_PARSE_INCOMPLETE;
+    for (size_t i = 0; i < json.size() && ret == LEPT_PARSE_INCOMPLETE; i += 65536)
+        ret = p.lept_feed(json.data() + i, json.size() - i < 65536 ? json.size() - i : 65536);
+    if (ret == LEPT_PARSE_INCOMPLETE)
+        ret = p.lept_finish();
+    v.lept_free();
+    return ret;
+}
+
+struct bench_result {
+    std::string name;
+    double mbps;
+};
+
+/* best of repeat runs, in MB/s */
+static double bench_run(bench_fn fn, const std::string& json, int repeat) {
+    lept_size_hints hints;
+    double best = 0;
+    if (fn(json, &hints) != LEPT_PARSE_OK) {
+        fprintf(stderr, "benchmark document does not parse\n");
+        exit(2);
+    }
+    for (int i = 0; i < repeat; i++) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        fn(json, &hints);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (best == 0 || s < best)
+            best = s;
+    }
+    return json.size() / (1024.0 * 1024.0) / best;
+}
+
+static int bench_load(const char* path, std::vector<bench_result>* results) {
+    FILE* fp = fopen(path, "r");
+    char name[128];
+    double mbps;
+    if (fp == NULL)
+        return 0;
+    while (fscanf(fp, "%127s %lf", name, &mbps) == 2) {
+        bench_result r = { name, mbps };
+        results->push_back(r);
+    }
+    fclose(fp);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    static const struct { const char* name; bench_fn fn; } modes[] = {
+        { "parse", bench_parse },
+        { "parse_strict", bench_parse_strict },
+        { "parse_hints", bench_parse_hints },
+        { "validate", bench_validate },
+        { "stream", bench_stream }
+    };
+    const char* save = NULL;
+    const char* baseline = NULL;
+    double threshold = 10;
+    int repeat = 5, scale = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-repeat=", 8) == 0)
+            repeat = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "-scale=", 7) == 0)
+            scale = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "-save=", 6) == 0)
+            save = argv[i] + 6;
+        else if (strncmp(argv[i], "-baseline=", 10) == 0)
+            baseline = argv[i] + 10;
+        else if (strncmp(argv[i], "-threshold=", 11) == 0)
+            threshold = atof(argv[i] + 11);
+        else {
+            fprintf(stderr, "usage: %s [-repeat=N] [-scale=K] [-save=FILE] [-baseline=FILE] [-threshold=PCT]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::string docs[] = { bench_numbers(scale), bench_strings(scale), bench_records(scale) };
+    const char* const doc_names[] = { "numbers", "strings", "records" };
+    std::vector<bench_result> results;
+    for (size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++)
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            bench_result r = { std::string(doc_names[d]) + "/" + modes[m].name, bench_run(modes[m].fn, docs[d], repeat) };
+            printf("%-24s %10.1f MB/s\n", r.name.c_str(), r.mbps);
+            results.push_back(r);
+        }
+
+    if (save) {
+        FILE* fp = fopen(save, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "cannot write %s\n", save);
+            return 2;
+        }
+        for (size_t i = 0; i < results.size(); i++)
+            fprintf(fp, "%s %.1f\n", results[i].name.c_str(), results[i].mbps);
+        fclose(fp);
+    }
+
+    int ret = 0;
+    if (baseline) {
+        std::vector<bench_result> base;
+        if (!bench_load(baseline, &base)) {
+            fprintf(stderr, "cannot read %s\n", baseline);
+            return 2;
+        }
+        for (size_t i = 0; i < base.size(); i++)
+            for (size_t j = 0; j < results.size(); j++)
+                if (results[j].name == base[i].name && results[j].mbps < base[i].mbps * (1 - threshold / 100)) {
+                    printf("REGRESSION %s: %.1f MB/s, baseline %.1f MB/s (%.1f%%)\n", base[i].name.c_str(),
+                        results[j].mbps, base[i].mbps, (results[j].mbps / base[i].mbps - 1) * 100);
+                    ret = 1;
+                }
+        if (ret == 0)
+            printf("no regression beyond %.1f%% against %s\n", threshold, baseline);
+    }
+    return ret;
+}
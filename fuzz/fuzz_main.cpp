@@ -0,0 +1,153 @@
+/**
+ * standalone driver for the fuzz targets, used when libFuzzer is not linked in
+ *
+ *     leptjson_fuzz [-runs=N] [-seed=S] [file or directory ...]
+ *
+ * every input file is run once (stdin when none is given, which is what AFL expects); with
+ * -runs=N the inputs are then mutated N times with a deterministic pseudo-random generator;
+ * an input that aborts is saved to crash-input for replay
+ **/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size);
+
+static const std::string* fuzz_current = NULL;
+
+static void fuzz_crash(int sig) {
+    FILE* fp = fopen("crash-input", "wb");
+    if (fp != NULL && fuzz_current != NULL) {
+        fwrite(fuzz_current->data(), 1, fuzz_current->size(), fp);
+        fprintf(stderr, "input saved to crash-input\n");
+    }
+    if (fp != NULL)
+        fclose(fp);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void fuzz_run(const std::string& s) {
+    fuzz_current = &s;
+    LLVMFuzzerTestOneInput((const unsigned char*)s.data(), s.size());
+    fuzz_current = NULL;
+}
+
+static unsigned long long fuzz_state = 0x9E3779B97F4A7C15ULL;
+
+/* xorshift64* */
+static unsigned long long fuzz_random() {
+    fuzz_state ^= fuzz_state >> 12;
+    fuzz_state ^= fuzz_state << 25;
+    fuzz_state ^= fuzz_state >> 27;
+    return fuzz_state * 0x2545F4914F6CDD1DULL;
+}
+
+static int fuzz_read_file(const char* path, std::string* out) {
+    FILE* fp = fopen(path, "rb");
+    char buf[4096];
+    size_t n;
+    if (fp == NULL)
+        return 0;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        out->append(buf, n);
+    fclose(fp);
+    return 1;
+}
+
+static void fuzz_load(const char* path, std::vector<std::string>* inputs) {
+    std::string s;
+#if defined(__unix__) || defined(__APPLE__)
+    DIR* dir = opendir(path);
+    if (dir != NULL) {
+        struct dirent* e;
+        while ((e = readdir(dir)) != NULL)
+            if (e->d_name[0] != '.')
+                fuzz_load((std::string(path) + "/" + e->d_name).c_str(), inputs);
+        closedir(dir);
+        return;
+    }
+#endif
+    if (!fuzz_read_file(path, &s)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        exit(1);
+    }
+    inputs->push_back(s);
+}
+
+/* JSON-aware mutations: structural tokens are more useful than random bytes */
+static void fuzz_mutate(std::string* s, const std::vector<std::string>& inputs) {
+    static const char* const tokens[] = {
+        "[", "]", "{", "}", ",", ":", "\"", "\\", "\\u", "\\uD800", "\\uDC00", "null", "true", "false",
+        "0", "-", ".", "e", "E+", "1e309", "\xC0", "\xE2\x82", "\xF4\x90\x80\x80", "\x01", " ", "\0"
+    };
+    size_t pos = s->empty() ? 0 : fuzz_random() % (s->size() + 1);
+    switch (fuzz_random() % 6) {
+        case 0:     /* flip a byte */
+            if (!s->empty())
+                (*s)[pos % s->size()] ^= (char)(1 << (fuzz_random() % 8));
+            break;
+        case 1:     /* erase a run */
+            if (!s->empty())
+                s->erase(pos % s->size(), 1 + fuzz_random() % 8);
+            break;
+        case 2:     /* insert a token */
+        case 3: {
+            const char* t = tokens[fuzz_random() % (sizeof(tokens) / sizeof(tokens[0]))];
+            s->insert(pos, t, t[0] ? strlen(t) : 1);
+            break;
+        }
+        case 4:     /* duplicate a run */
+            if (!s->empty()) {
+                size_t from = fuzz_random() % s->size();
+                s->insert(pos, s->substr(from, 1 + fuzz_random() % 16));
+            }
+            break;
+        default: {  /* splice with another input */
+            const std::string& o = inputs[fuzz_random() % inputs.size()];
+            size_t from = o.empty() ? 0 : fuzz_random() % o.size();
+            s->replace(pos, fuzz_random() % 16, o.substr(from, fuzz_random() % 64));
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    long runs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+            runs = atol(argv[i] + 6);
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+            fuzz_state ^= strtoull(argv[i] + 6, NULL, 10) * 0x9E3779B97F4A7C15ULL;
+        else
+            fuzz_load(argv[i], &inputs);
+    }
+    if (inputs.empty()) {
+        std::string s;
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+            s.append(buf, n);
+        inputs.push_back(s);
+    }
+    signal(SIGABRT, fuzz_crash);
+    signal(SIGSEGV, fuzz_crash);
+    for (size_t i = 0; i < inputs.size(); i++)
+        fuzz_run(inputs[i]);
+    for (long r = 0; r < runs; r++) {
+        std::string s = inputs[fuzz_random() % inputs.size()];
+        for (int k = 1 + fuzz_random() % 4; k > 0; k--)
+            fuzz_mutate(&s, inputs);
+        fuzz_run(s);
+    }
+    printf("%zu inputs, %ld mutations passed\n", inputs.size(), runs);
+    return 0;
+}
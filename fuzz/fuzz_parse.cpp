@@ -0,0 +1,258 @@
+/**
+ * differential fuzz target: every parse mode must agree with the reference lept_parse(), and
+ * equality, hashing, diffs and struct bindings must stay consistent with each other; the input is
+ * also decoded as CBOR
+ *
+ * libFuzzer: build with -DLEPT_LIBFUZZER=ON (clang), run ./leptjson_fuzz corpus/
+ * AFL:       build with afl-clang++ as the compiler, run afl-fuzz -i corpus -o out -- ./leptjson_fuzz @@
+ * otherwise fuzz_main.cpp replays files and runs a small built-in mutator
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "leptjson.h"
+#include "leptjson_bind.h"
+
+using namespace leptjson;
+
+#define FUZZ_CHECK(cond, what) \
+    do {\
+        if (!(cond)) {\
+            fprintf(stderr, "%s:%d: %s mismatch: %s\n", __FILE__, __LINE__, what, #cond);\
+            abort();\
+        }\
+    } while(0)
+
+/* order sensitive comparison, duplicate keys included (lept_is_equal looks keys up) */
+static int fuzz_same(lept_value* a, lept_value* b) {
+    if (a->lept_get_type() != b->lept_get_type())
+        return 0;
+    switch (a->lept_get_type()) {
+        case LEPT_NUMBER:
+            return a->lept_get_number() == b->lept_get_number();
+        case LEPT_STRING:
+            return a->lept_get_string_length() == b->lept_get_string_length() &&
+                memcmp(a->lept_get_string(), b->lept_get_string(), a->lept_get_string_length()) == 0;
+        case LEPT_ARRAY:
+            if (a->lept_get_array_size() != b->lept_get_array_size())
+                return 0;
+            for (size_t i = 0; i < a->lept_get_array_size(); i++)
+                if (!fuzz_same(a->lept_get_array_element(i), b->lept_get_array_element(i)))
+                    return 0;
+            return 1;
+        case LEPT_OBJECT:
+            if (a->lept_get_object_size() != b->lept_get_object_size())
+                return 0;
+            for (size_t i = 0; i < a->lept_get_object_size(); i++)
+                if (a->lept_get_object_key_length(i) != b->lept_get_object_key_length(i) ||
+                    memcmp(a->lept_get_object_key(i), b->lept_get_object_key(i), a->lept_get_object_key_length(i)) != 0 ||
+                    !fuzz_same(a->lept_get_object_value(i), b->lept_get_object_value(i)))
+                    return 0;
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+static void fuzz_mode(const char* mode, int expect, lept_value* ref, int ret, lept_value* v) {
+    if (ret != expect) {
+        fprintf(stderr, "%s: returned %d, reference %d\n", mode, ret, expect);
+        abort();
+    }
+    if (ret == LEPT_PARSE_OK)
+        FUZZ_CHECK(fuzz_same(ref, v), mode);
+    else
+        FUZZ_CHECK(v->lept_get_type() == LEPT_NULL, mode);
+    v->lept_free();
+}
+
+/* feed json in chunks whose sizes come from the input itself */
+static int fuzz_stream(const char* json, size_t len, int flags, lept_value* v) {
+    lept_stream_parser p(v, flags);
+    int ret = LEPT_PARSE_INCOMPLETE;
+    for (size_t i = 0, k = 0; i < len && ret == LEPT_PARSE_INCOMPLETE; k++) {
+        size_t n = 1 + (unsigned char)json[k % len] % 13;
+        if (n > len - i)
+            n = len - i;
+        ret = p.lept_feed(json + i, n);
+        i += n;
+    }
+    return ret == LEPT_PARSE_INCOMPLETE ? p.lept_finish() : ret;
+}
+
+static void fuzz_roundtrips(lept_value* ref) {
+    lept_value v;
+    size_t length;
+
+    char* cbor = ref->lept_stringify_cbor(&length);
+    FUZZ_CHECK(v.lept_parse_cbor(cbor, length) == LEPT_PARSE_OK, "cbor");
+    FUZZ_CHECK(fuzz_same(ref, &v), "cbor");
+    v.lept_free();
+    FUZZ_CHECK(v.lept_parse_cbor(cbor, length, LEPT_PARSE_ZERO_COPY) == LEPT_PARSE_OK, "cbor zero copy");
+    FUZZ_CHECK(fuzz_same(ref, &v), "cbor zero copy");
+    v.lept_free();
+    free(cbor);
+
+    lept_image image;
+    char* data = ref->lept_stringify_image(&length);
+    FUZZ_CHECK(image.lept_load(data, length) == LEPT_IMAGE_OK, "image");
+    image.lept_get_root()->lept_to_value(&v);
+    FUZZ_CHECK(fuzz_same(ref, &v), "image");
+    v.lept_free();
+    image.lept_close();
+    free(data);
+
+    lept_value copy;
+    copy.lept_copy(ref);
+    FUZZ_CHECK(fuzz_same(ref, &copy), "copy");
+    FUZZ_CHECK(ref->lept_hash() == copy.lept_hash(), "hash");
+    copy.lept_free();
+}
+
+/* equality is symmetric and equal values hash alike */
+static void fuzz_equal(lept_value* a, lept_value* b) {
+    int equal = a->lept_is_equal(b);
+    FUZZ_CHECK(equal == b->lept_is_equal(a), "equal symmetry");
+    if (equal)
+        FUZZ_CHECK(a->lept_hash() == b->lept_hash(), "hash of equal values");
+}
+
+/* the patch from a to b must turn a copy of a into b */
+static void fuzz_diff(lept_value* a, lept_value* b) {
+    lept_value patch, doc;
+    fuzz_equal(a, b);
+    lept_diff(a, b, &patch);
+    doc.lept_copy(a);
+    FUZZ_CHECK(lept_apply_patch(&doc, &patch) == LEPT_PATCH_OK, "diff apply");
+    FUZZ_CHECK(doc.lept_is_equal(b), "diff apply");
+    fuzz_equal(&doc, b);
+    if (a->lept_is_equal(b))
+        FUZZ_CHECK(patch.lept_get_array_size() == 0, "diff of equal values");
+    doc.lept_free();
+    patch.lept_free();
+}
+
+/* diff the document against its own first child, and two documents on either side of a newline */
+static void fuzz_diffs(const char* json, lept_value* ref) {
+    lept_value* child = NULL;
+    if (ref->lept_get_type() == LEPT_ARRAY && ref->lept_get_array_size() > 0)
+        child = ref->lept_get_array_element(0);
+    else if (ref->lept_get_type() == LEPT_OBJECT && ref->lept_get_object_size() > 0)
+        child = ref->lept_get_object_value(0);
+    fuzz_diff(ref, ref);
+    if (child != NULL) {
+        fuzz_diff(ref, child);
+        fuzz_diff(child, ref);
+    }
+
+    const char* nl = strchr(json, '\n');
+    if (nl == NULL)
+        return;
+    char* first = (char*)malloc(nl - json + 1);
+    memcpy(first, json, nl - json);
+    first[nl - json] = '\0';
+    lept_value a, b;
+    if (a.lept_parse(first) == LEPT_PARSE_OK && b.lept_parse(nl + 1) == LEPT_PARSE_OK) {
+        fuzz_diff(&a, &b);
+        fuzz_diff(&b, &a);
+    }
+    a.lept_free();
+    b.lept_free();
+    free(first);
+}
+
+/* the raw input as CBOR: whatever decodes must behave like a parsed document */
+static void fuzz_cbor(const unsigned char* data, size_t size) {
+    static const int modes[] = { LEPT_PARSE_DEFAULT, LEPT_PARSE_ZERO_COPY };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        lept_value v;
+        if (v.lept_parse_cbor((const char*)data, size, modes[m]) != LEPT_PARSE_OK) {
+            FUZZ_CHECK(v.lept_get_type() == LEPT_NULL, "cbor decode");
+            continue;
+        }
+        FUZZ_CHECK(v.lept_is_equal(&v), "cbor self equality");
+        fuzz_diff(&v, &v);
+        fuzz_roundtrips(&v);
+        v.lept_free();
+    }
+}
+
+struct fuzz_point {
+    double x;
+    std::optional<int> y;
+};
+
+struct fuzz_record {
+    bool b;
+    int i;
+    long long l;
+    unsigned long long u;
+    float f;
+    double d;
+    std::string s;
+    std::vector<fuzz_point> p;
+    std::optional<std::vector<std::string>> t;
+};
+
+LEPT_BIND(fuzz_point, LEPT_FIELD(fuzz_point, x), LEPT_FIELD(fuzz_point, y))
+LEPT_BIND(fuzz_record,
+    LEPT_FIELD(fuzz_record, b), LEPT_FIELD(fuzz_record, i), LEPT_FIELD(fuzz_record, l),
+    LEPT_FIELD(fuzz_record, u), LEPT_FIELD(fuzz_record, f), LEPT_FIELD(fuzz_record, d),
+    LEPT_FIELD(fuzz_record, s), LEPT_FIELD(fuzz_record, p), LEPT_FIELD(fuzz_record, t))
+
+/* a bound document is valid JSON, and stringifying the struct must parse back to the same text */
+static void fuzz_bind(const char* json, int flags, int expect) {
+    fuzz_record r = fuzz_record(), r2 = fuzz_record();
+    if (lept_bind_parse(json, &r, flags) != LEPT_PARSE_OK)
+        return;
+    FUZZ_CHECK(expect == LEPT_PARSE_OK, "bind");
+    std::string text, text2;
+    lept_bind_stringify(r, &text);
+    FUZZ_CHECK(lept_bind_parse(text.c_str(), &r2, flags) == LEPT_PARSE_OK, "bind round trip");
+    lept_bind_stringify(r2, &text2);
+    FUZZ_CHECK(text == text2, "bind round trip");
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size) {
+    static const int modes[] = { LEPT_PARSE_DEFAULT, LEPT_PARSE_STRICT_UTF8 };
+    /* the parser reads NUL-terminated text, it stops at the first NUL like lept_parse() */
+    char* json = (char*)malloc(size + 1);
+    memcpy(json, data, size);
+    json[size] = '\0';
+    size_t len = strlen(json);
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        int flags = modes[m];
+        lept_value ref, v;
+        int expect = ref.lept_parse(json, flags);
+
+        lept_size_hints hints;
+        fuzz_mode("hints", expect, &ref, v.lept_parse(json, flags, &hints), &v);
+        fuzz_mode("hints reused", expect, &ref, v.lept_parse(json, flags, &hints), &v);
+
+        fuzz_mode("stream", expect, &ref, fuzz_stream(json, len, flags, &v), &v);
+
+        if (flags & LEPT_PARSE_STRICT_UTF8)
+            FUZZ_CHECK(lept_validate(json, len) == expect, "validate");
+        lept_reader r(json, flags);
+        int ret = r.lept_skip();
+        FUZZ_CHECK((ret == LEPT_PARSE_OK ? r.lept_read_end() : ret) == expect, "reader skip");
+
+        fuzz_bind(json, flags, expect);
+
+        if (expect == LEPT_PARSE_OK)
+            fuzz_roundtrips(&ref);
+        ref.lept_free();
+    }
+
+    fuzz_cbor(data, size);
+
+    /* a failed parse leaves null, the halves around a newline are still diffed */
+    lept_value ref;
+    ref.lept_parse(json);
+    fuzz_diffs(json, &ref);
+    ref.lept_free();
+    free(json);
+    return 0;
+}
@@ -5,6 +5,17 @@
 #include <cstdio>
 #include <errno.h>
 #include <cmath>
+#include <cfloat>
+#if defined(__unix__) || defined(__APPLE__)
+#define LEPT_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef LEPT_ENABLE_STATS
+#include <chrono>
+#endif
 
 namespace leptjson {
 
@@ -15,16 +26,58 @@ namespace leptjson {
 #define EXPECT(c, ch)       do { assert(*c->json == (ch)); c->json++; } while(0)
 #define ISDIGIT(ch)         ((ch) >= '0' && (ch) <= '9')
 #define ISDIGIT1TO9(ch)     ((ch) >= '1' && (ch) <= '9')
-#define ISATOFLOW(ch)       ((ch) >= 'a' && (ch) <= 'f')
-#define ISATOFHIGH(ch)      ((ch) >= 'A' && (ch) <= 'F')
-#define ISHEX(ch)           (ISDIGIT(ch) || ISATOFLOW(ch) || ISATOFHIGH(ch))
 #define PUTC(c, ch) do { *(char*)lept_context_push(c, sizeof(char)) = (ch); } while(0)
+#define PUTS(c, s, len)     do { if ((len) > 0) memcpy(lept_context_push(c, len), s, len); } while(0)
 
-typedef struct {
+struct lept_context {
     const char* json;
     char* stack;
     size_t size, top;
-} lept_context;
+    int flags;
+    lept_size_hints* hints;     /* non NULL: containers are allocated from size hints */
+    const char* end;            /* end of the input, only set together with hints */
+    size_t container;           /* index of the next container in hints */
+#ifdef LEPT_ENABLE_STATS
+    size_t depth;
+#endif
+};
+
+#ifdef LEPT_ENABLE_STATS
+/* statistics of the parse running on this thread, NULL when not requested */
+static thread_local lept_parse_stats* lept_stats = NULL;
+
+static unsigned long long lept_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#define STAT_ADD(field, n)  do { if (lept_stats) lept_stats->field += (n); } while(0)
+#define STAT_MAX(field, n)  do { if (lept_stats && lept_stats->field < (n)) lept_stats->field = (n); } while(0)
+#define STAT_START(t)       unsigned long long t = lept_stats ? lept_clock_ns() : 0
+#define STAT_STOP(field, t) STAT_ADD(field, lept_clock_ns() - (t))
+#define STAT_ENTER(c)       do { (c)->depth++; STAT_MAX(max_depth, (c)->depth); } while(0)
+#define STAT_LEAVE(c)       do { (c)->depth--; } while(0)
+#else
+#define STAT_ADD(field, n)  do {} while(0)
+#define STAT_MAX(field, n)  do {} while(0)
+#define STAT_START(t)       do {} while(0)
+#define STAT_STOP(field, t) do {} while(0)
+#define STAT_ENTER(c)       do {} while(0)
+#define STAT_LEAVE(c)       do {} while(0)
+#endif
+
+/* allocations made while building values, counted when statistics are enabled */
+static void* lept_malloc(size_t size) {
+    STAT_ADD(mallocs, 1);
+    STAT_ADD(malloc_bytes, size);
+    return malloc(size);
+}
+
+static void* lept_realloc(void* ptr, size_t size) {
+    STAT_ADD(mallocs, 1);
+    STAT_ADD(malloc_bytes, size);
+    return realloc(ptr, size);
+}
 
 
 static void* lept_context_push(lept_context* c, size_t size) {
@@ -35,10 +88,12 @@ static void* lept_context_push(lept_context* c, size_t size) {
             c->size = LEPT_PARSE_STACK_INIT_SIZE;
         while (c->top + size >= c->size)
             c->size += c->size >> 1;  /* c->size * 1.5 */
-        c->stack = (char*)realloc(c->stack, c->size);
+        c->stack = (char*)lept_realloc(c->stack, c->size);
+        STAT_ADD(stack_reallocs, 1);
     }
     ret = c->stack + c->top;
     c->top += size;
+    STAT_MAX(stack_peak, c->top);
     return ret;
 }
 
@@ -65,27 +120,153 @@ static int lept_parse_literal(lept_context* c, lept_value* v, const char *str, l
     return LEPT_PARSE_OK;
 }
 
-static int lept_parse_number(lept_context* c, lept_value* v) {
-    char* end;
-    /*  validate number */
-    const char* ch = c->json;
-    if (!ISDIGIT(*ch) && *ch != '-') 
-        return LEPT_PARSE_INVALID_VALUE;
-    ch++;
-    while (ISDIGIT1TO9(*ch) || *ch == '.') {
-        ch++;
+/* current character, '\0' past end; end == NULL means the input is NUL-terminated */
+#define PEEK(p, end)        (((end) == NULL || (p) < (end)) ? *(p) : '\0')
+
+/**
+ * scan a number: [ "-" ] ( "0" | digit1-9 *digit ) [ "." 1*digit ] [ ( "e" | "E" ) [ "+" | "-" ] 1*digit ]
+ * @return pointer past the number, or NULL if it is malformed
+ **/
+static const char* lept_scan_number(const char* p, const char* end) {
+    if (PEEK(p, end) == '-')
+        p++;
+    if (PEEK(p, end) == '0')
+        p++;
+    else {
+        if (!ISDIGIT1TO9(PEEK(p, end)))
+            return NULL;
+        for (p++; ISDIGIT(PEEK(p, end)); p++);
     }
-    if (*(ch - 1) == '.')
-        return LEPT_PARSE_INVALID_VALUE;
+    if (PEEK(p, end) == '.') {
+        p++;
+        if (!ISDIGIT(PEEK(p, end)))
+            return NULL;
+        for (p++; ISDIGIT(PEEK(p, end)); p++);
+    }
+    if (PEEK(p, end) == 'e' || PEEK(p, end) == 'E') {
+        p++;
+        if (PEEK(p, end) == '+' || PEEK(p, end) == '-')
+            p++;
+        if (!ISDIGIT(PEEK(p, end)))
+            return NULL;
+        for (p++; ISDIGIT(PEEK(p, end)); p++);
+    }
+    return p;
+}
 
-    double n = strtod(c->json, &end);
-    if (c->json == end)
+static int lept_parse_number(lept_context* c, lept_value* v) {
+    const char* end = lept_scan_number(c->json, NULL);
+    if (end == NULL)
         return LEPT_PARSE_INVALID_VALUE;
+
+    STAT_ADD(numbers, 1);
+    STAT_START(t);
+    char* tail;
+    errno = 0;
+    double n = strtod(c->json, &tail);
+    STAT_STOP(number_ns, t);
+    /* strtod reads on after a leading zero ("0123", "0x1"), the number itself is just the zero */
+    if (tail != end) {
+        n = *c->json == '-' ? -0.0 : 0.0;
+        errno = 0;
+    }
+    if (errno == ERANGE && (n == HUGE_VAL || n == -HUGE_VAL))
+        return LEPT_PARSE_NUMBER_TOO_BIG;
     c->json = end;
     v->lept_set_number(n);
     return LEPT_PARSE_OK;
 }
 
+/* character classes for the string scanner, indexed by unsigned byte */
+enum {
+    LEPT_CH_PLAIN,      /* copied as is */
+    LEPT_CH_UTF8,       /* non-ASCII byte, copied as is unless validating */
+    LEPT_CH_QUOTE,
+    LEPT_CH_ESCAPE,
+    LEPT_CH_CTRL,
+    LEPT_CH_END
+};
+
+#define CH16(x) x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x
+static const unsigned char lept_string_class[256] = {
+    LEPT_CH_END, LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL,
+    LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL,
+    LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL,
+    LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL, LEPT_CH_CTRL,     /* 0x00 */
+    CH16(LEPT_CH_CTRL),                                         /* 0x10 */
+    0, 0, LEPT_CH_QUOTE, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x20 */
+    CH16(0), CH16(0),                                           /* 0x30, 0x40 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, LEPT_CH_ESCAPE, 0, 0, 0, /* 0x50 */
+    CH16(0), CH16(0),                                           /* 0x60, 0x70 */
+    CH16(LEPT_CH_UTF8), CH16(LEPT_CH_UTF8), CH16(LEPT_CH_UTF8), CH16(LEPT_CH_UTF8),
+    CH16(LEPT_CH_UTF8), CH16(LEPT_CH_UTF8), CH16(LEPT_CH_UTF8), CH16(LEPT_CH_UTF8)
+};
+
+/* hex digit values, -1 for non hex characters */
+static const signed char lept_hex_digit[256] = {
+    CH16(-1), CH16(-1), CH16(-1),                                   /* 0x00 - 0x2F */
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,           /* 0x30 */
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, /* 0x40 */
+    CH16(-1),                                                       /* 0x50 */
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, /* 0x60 */
+    CH16(-1),                                                       /* 0x70 */
+    CH16(-1), CH16(-1), CH16(-1), CH16(-1), CH16(-1), CH16(-1), CH16(-1), CH16(-1)
+};
+
+/* well-formed UTF-8 sequences (Unicode Table 3-7), keyed by lead byte */
+typedef struct { unsigned char len, lo, hi; } lept_utf8_range;
+
+static const lept_utf8_range lept_utf8_ranges[8] = {
+    { 0, 0x00, 0x00 },  /* not a lead byte */
+    { 2, 0x80, 0xBF },  /* C2..DF */
+    { 3, 0xA0, 0xBF },  /* E0: no overlong forms */
+    { 3, 0x80, 0xBF },  /* E1..EC, EE..EF */
+    { 3, 0x80, 0x9F },  /* ED: no surrogates */
+    { 4, 0x90, 0xBF },  /* F0: no overlong forms */
+    { 4, 0x80, 0xBF },  /* F1..F3 */
+    { 4, 0x80, 0x8F }   /* F4: up to U+10FFFF */
+};
+
+/* index into lept_utf8_ranges for bytes 0x80..0xFF */
+static const unsigned char lept_utf8_lead[128] = {
+    CH16(0), CH16(0), CH16(0), CH16(0),                 /* 0x80 - 0xBF */
+    0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* 0xC0 */
+    CH16(1),                                            /* 0xD0 */
+    2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3,     /* 0xE0 */
+    5, 6, 6, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0      /* 0xF0 */
+};
+#undef CH16
+
+/**
+ * check one UTF-8 sequence
+ * @param p pointer to a byte >= 0x80
+ * @return length of the sequence, or 0 if it is ill-formed
+ **/
+static size_t lept_utf8_sequence(const char* p) {
+    const unsigned char* s = (const unsigned char*)p;
+    const lept_utf8_range* r = &lept_utf8_ranges[lept_utf8_lead[s[0] - 0x80]];
+    if (r->len == 0 || s[1] < r->lo || s[1] > r->hi)
+        return 0;
+    for (size_t i = 2; i < r->len; i++)
+        if ((s[i] & 0xC0) != 0x80)
+            return 0;
+    return r->len;
+}
+
+/* check that len bytes at s are well-formed UTF-8 */
+static int lept_utf8_valid(const char* s, size_t len) {
+    for (size_t i = 0; i < len;) {
+        size_t n = 1;
+        if ((unsigned char)s[i] >= 0x80) {
+            n = lept_utf8_ranges[lept_utf8_lead[(unsigned char)s[i] - 0x80]].len;
+            if (n == 0 || n > len - i || lept_utf8_sequence(s + i) != n)
+                return 0;
+        }
+        i += n;
+    }
+    return 1;
+}
+
 /**
  * parse unicode hex4
  * @param p pointer to next character
@@ -93,65 +274,82 @@ static int lept_parse_number(lept_context* c, lept_value* v) {
  * @return pointer to next character or NULL
  **/
 static const char* lept_parse_hex4(const char* p, unsigned* u) {
+    *u = 0;
     for (int i = 0; i < 4; i++) {
-        if (!ISHEX(*p))
+        int d = lept_hex_digit[(unsigned char)p[i]];
+        if (d < 0)
             return NULL;
-        unsigned d = *p - '0';
-        *u <<= 4;
-        *u |= d;
-        p++;
+        *u = (*u << 4) | d;
     }
-    return p;
+    return p + 4;
 }
 
 static void lept_encode_utf8(lept_context* c, unsigned u) {
-    if (u >= 0x0000 && u <= 0x007F) {
-        PUTC(c, u);
+    char buf[4];
+    size_t len;
+    if (u <= 0x7F) {
+        buf[0] = (char)u;
+        len = 1;
     }
-
-    if (u >= 0x0080 && u <= 0x07FF) {
-        PUTC(c, 0xC0 | ((u >>  6) & 0xFF)); /* 0xC0 = 11000000 */
-        PUTC(c, 0x80 | ( u        & 0x3F)); /* 0x3F = 00011111 */
+    else if (u <= 0x7FF) {
+        buf[0] = (char)(0xC0 | (u >> 6));           /* 0xC0 = 11000000 */
+        buf[1] = (char)(0x80 | (u & 0x3F));         /* 0x3F = 00111111 */
+        len = 2;
     }
-
-    if (u >= 0x0800 && u <= 0xFFFF) {
-        PUTC(c, 0xE0 | ((u >> 12) & 0xFF)); /* 0xE0 = 11100000 */
-        PUTC(c, 0x80 | ((u >>  6) & 0x3F)); /* 0x80 = 10000000 */
-        PUTC(c, 0x80 | ( u        & 0x3F)); /* 0x3F = 00111111 */
+    else if (u <= 0xFFFF) {
+        buf[0] = (char)(0xE0 | (u >> 12));          /* 0xE0 = 11100000 */
+        buf[1] = (char)(0x80 | ((u >> 6) & 0x3F));  /* 0x80 = 10000000 */
+        buf[2] = (char)(0x80 | (u & 0x3F));
+        len = 3;
     }
-
-    if (u >= 0x10000 && u <= 0x10FFFF) {
-        PUTC(c, 0xF0 | ((u >> 18) & 0xFF)); /* 0xF0 = 11110000 */
-        PUTC(c, 0x80 | ((u >> 12) & 0x3F)); /* 0xE0 = 11100000 */
-        PUTC(c, 0x80 | ((u >>  6) & 0x3F)); /* 0x80 = 10000000 */
-        PUTC(c, 0x80 | ( u        & 0x3F)); /* 0x3F = 00111111 */
+    else {
+        assert(u <= 0x10FFFF);
+        buf[0] = (char)(0xF0 | (u >> 18));          /* 0xF0 = 11110000 */
+        buf[1] = (char)(0x80 | ((u >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((u >>  6) & 0x3F));
+        buf[3] = (char)(0x80 | (u & 0x3F));
+        len = 4;
     }
+    memcpy(lept_context_push(c, len), buf, len);
 }
 
 #define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
 
 /* 解析 JSON 字符串，把结果写入 str 和 len */
 /* str 指向 c->stack 中的元素，需要在 c->stack  */
-static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
+static int lept_parse_string_chars(lept_context* c, char** str, size_t* len) {
     unsigned u, u2;
-    size_t head = c->top;
+    size_t head = c->top, n;
+    /* bytes >= 0x80 are only copied blindly when not validating */
+    unsigned char plain = (c->flags & LEPT_PARSE_STRICT_UTF8) ? LEPT_CH_PLAIN : LEPT_CH_UTF8;
     const char* p;
     EXPECT(c, '\"');
     p = c->json;
     for (;;) {
-        char ch = *p++;
-        if ('\x01' <= ch && ch <= '\x1F')
-            return LEPT_PARSE_INVALID_STRING_CHAR;
-        switch (ch) {
-            case '\"':
+        /* copy a run of ordinary characters at once */
+        const char* run = p;
+        while (lept_string_class[(unsigned char)*p] <= plain)
+            p++;
+        if (p != run)
+            memcpy(lept_context_push(c, p - run), run, p - run);
+        switch (lept_string_class[(unsigned char)*p++]) {
+            case LEPT_CH_QUOTE:
                 *len = c->top - head;
                 *str = (char *)lept_context_pop(c, *len);
                 c->json = p;
                 return LEPT_PARSE_OK;
-            case '\0':
-                c->top = head;
-                return LEPT_PARSE_MISS_QUOTATION_MARK;
-            case '\\':
+            case LEPT_CH_END:
+                STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
+            case LEPT_CH_CTRL:
+                STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
+            case LEPT_CH_UTF8:
+                if ((n = lept_utf8_sequence(p - 1)) == 0)
+                    STRING_ERROR(LEPT_PARSE_INVALID_UTF8);
+                memcpy(lept_context_push(c, n), p - 1, n);
+                p += n - 1;
+                break;
+            case LEPT_CH_ESCAPE:
+                STAT_ADD(escapes, 1);
                 switch (*p++) {
                     case '\"': PUTC(c, '\"'); break;
                     case '\\': PUTC(c, '\\'); break;
@@ -165,30 +363,35 @@ static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
                         if (!(p = lept_parse_hex4(p, &u)))
                             STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                         /* surrogate handling */
-                        if (*(p + 1) != '\\' || *(p + 2) != 'u')
-                           STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE); 
-                        p += 2;
                         if (u >= 0xD800 && u <= 0xDBFF) {
-                            if (!(p = lept_parse_hex4(p, &u2)))
+                            if (p[0] != '\\' || p[1] != 'u')
+                                STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
+                            if (!(p = lept_parse_hex4(p + 2, &u2)))
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
                             if (!(u2 >= 0xDC00 && u2 <= 0xDFFF))
-                               STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE); 
-                            int high = u;
-                            int low = u2;
-                            u = 0x10000 + (high - 0xD800) * 0x400 + (low - 0xDC00);
+                                STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
+                            u = 0x10000 + ((u - 0xD800) << 10) + (u2 - 0xDC00);
                         }
+                        else if (u >= 0xDC00 && u <= 0xDFFF)
+                            STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
                         lept_encode_utf8(c, u);
                         break;
                     default:
                         STRING_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE);
                 }
                 break;
-            default:
-                PUTC(c, ch);
         }
     }
 }
 
+static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
+    STAT_ADD(strings, 1);
+    STAT_START(t);
+    int ret = lept_parse_string_chars(c, str, len);
+    STAT_STOP(string_ns, t);
+    return ret;
+}
+
 static int lept_parse_string(lept_context* c, lept_value* v) {
     int ret;
     char* s;
@@ -198,6 +401,21 @@ static int lept_parse_string(lept_context* c, lept_value* v) {
     return ret;
 }
 
+/* append a member without looking for an existing key */
+static lept_value* lept_append_object_member(lept_value* o, const char* key, size_t klen) {
+    assert(o->type == LEPT_OBJECT);
+    if (o->u.o.size == o->u.o.capacity)
+        o->lept_reserve_object(o->u.o.capacity == 0 ? 1 : o->u.o.capacity * 2);
+    lept_member* m = &o->u.o.m[o->u.o.size++];
+    m->k = (char*)lept_malloc(klen + 1);
+    if (klen > 0)
+        memcpy(m->k, key, klen);
+    m->k[klen] = '\0';
+    m->klen = klen;
+    m->v = lept_value();
+    return &m->v;
+}
+
 static int lept_parse_value(lept_context* c, lept_value* v);
 
 static int lept_parse_array(lept_context* c, lept_value* v) {
@@ -208,7 +426,7 @@ static int lept_parse_array(lept_context* c, lept_value* v) {
     if (*c->json == ']') {
         c->json++;
         v->type = LEPT_ARRAY;
-        v->u.a.size = 0;
+        v->u.a.size = v->u.a.capacity = 0;
         v->u.a.e = NULL;
         return LEPT_PARSE_OK;
     }
@@ -216,13 +434,8 @@ static int lept_parse_array(lept_context* c, lept_value* v) {
         lept_value e;
 
         lept_parse_whitespace(c);
-        if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK) {
-            for (size_t i = 0; i < size; i++) {
-                lept_value* value = (lept_value*)(lept_context_pop(c, sizeof(lept_value)));
-                value->lept_free();
-            }
-            return ret;
-        }
+        if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK)
+            break;
         memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
         size++;
 
@@ -232,14 +445,22 @@ static int lept_parse_array(lept_context* c, lept_value* v) {
         else if (*c->json == ']') {
             c->json++;
             v->type = LEPT_ARRAY;
-            v->u.a.size = size;
+            v->u.a.size = v->u.a.capacity = size;
             size *= sizeof(lept_value);
-            memcpy(v->u.a.e = (lept_value*)malloc(size), lept_context_pop(c, size), size);
+            memcpy(v->u.a.e = (lept_value*)lept_malloc(size), lept_context_pop(c, size), size);
             return LEPT_PARSE_OK;
         }
-        else
-            return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        else {
+            ret = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
     }
+    /* Pop and free values on the stack */
+    for (size_t i = 0; i < size; i++) {
+        lept_value* value = (lept_value*)(lept_context_pop(c, sizeof(lept_value)));
+        value->lept_free();
+    }
+    return ret;
 }
 
 static int lept_parse_object(lept_context* c, lept_value* v) {
@@ -252,7 +473,7 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
         c->json++;
         v->type = LEPT_OBJECT;
         v->u.o.m = 0;
-        v->u.o.size = 0;
+        v->u.o.size = v->u.o.capacity = 0;
         return LEPT_PARSE_OK;
     }
     m.k = NULL;
@@ -264,8 +485,9 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
             ret = LEPT_PARSE_MISS_KEY;
             break;
         }
-        m.k = (char*)malloc(m.klen + 1);
-        memcpy(m.k, str, m.klen);
+        m.k = (char*)lept_malloc(m.klen + 1);
+        if (m.klen > 0)
+            memcpy(m.k, str, m.klen);
         m.k[m.klen] = '\0';
 
         /* parse ws colon ws */
@@ -282,6 +504,7 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
         memcpy(lept_context_push(c, sizeof(lept_member)), &m, sizeof(lept_member));
         size++;
         m.k = NULL; /* ownership is transferred to member on stack */
+        m.v = lept_value();
         /* parse ws [comma | right-curly-brace] ws */
         lept_parse_whitespace(c);
         if (*c->json == ',') {
@@ -290,9 +513,9 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
             c->json++;
             // clean
             v->type = LEPT_OBJECT;
-            v->u.o.size = size;
+            v->u.o.size = v->u.o.capacity = size;
             size *= sizeof(lept_member);
-            memcpy(v->u.o.m = (lept_member*)malloc(size), lept_context_pop(c, size), size);
+            memcpy(v->u.o.m = (lept_member*)lept_malloc(size), lept_context_pop(c, size), size);
             return LEPT_PARSE_OK;
         } else {
             ret = LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
@@ -300,6 +523,7 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
         }
         lept_parse_whitespace(c);
     }
+    free(m.k);
     /* Pop and free members on the stack */
     for (size_t i = 0; i < size; i++) {
         lept_member* m = (lept_member*)(lept_context_pop(c, sizeof(lept_member)));
@@ -309,7 +533,112 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
     return ret;
 }
 
+/* reserve the hint slot of the next container, *count receives its hint */
+static size_t lept_hint_slot(lept_context* c, size_t* count) {
+    lept_size_hints* h = c->hints;
+    size_t slot = c->container++;
+    if (slot >= h->capacity) {
+        h->capacity = h->capacity == 0 ? 16 : h->capacity * 2;
+        h->counts = (size_t*)lept_realloc(h->counts, h->capacity * sizeof(size_t));
+    }
+    if (slot >= h->size) {
+        h->counts[slot] = 0;
+        h->size = slot + 1;
+    }
+    *count = h->counts[slot];
+    return slot;
+}
+
+/**
+ * containers are filled in place, at the size given by their hint
+ * a hint is only trusted up to what the rest of the input can hold: an element takes at least
+ * two bytes with its separator, a member at least four, so stale hints cannot force huge allocations
+ **/
+static int lept_parse_array_sized(lept_context* c, lept_value* v) {
+    size_t count, slot = lept_hint_slot(c, &count);
+    int ret;
+    if (count > (size_t)(c->end - c->json) / 2)
+        count = (size_t)(c->end - c->json) / 2;
+    EXPECT(c, '[');
+    v->lept_set_array(count);
+    lept_parse_whitespace(c);
+    if (*c->json == ']') {
+        c->json++;
+        c->hints->counts[slot] = 0;
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        lept_parse_whitespace(c);
+        if ((ret = lept_parse_value(c, v->lept_pushback_array_element())) != LEPT_PARSE_OK)
+            break;
+        lept_parse_whitespace(c);
+        if (*c->json == ',')
+            c->json++;
+        else if (*c->json == ']') {
+            c->json++;
+            c->hints->counts[slot] = v->u.a.size;
+            return LEPT_PARSE_OK;
+        }
+        else {
+            ret = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
+    }
+    v->lept_free();
+    return ret;
+}
+
+static int lept_parse_object_sized(lept_context* c, lept_value* v) {
+    size_t count, slot = lept_hint_slot(c, &count), klen;
+    char* key;
+    int ret;
+    if (count > (size_t)(c->end - c->json) / 4)
+        count = (size_t)(c->end - c->json) / 4;
+    EXPECT(c, '{');
+    v->lept_set_object(count);
+    lept_parse_whitespace(c);
+    if (*c->json == '}') {
+        c->json++;
+        c->hints->counts[slot] = 0;
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        lept_value* m;
+        if (*c->json != '\"' || lept_parse_string_raw(c, &key, &klen) != LEPT_PARSE_OK) {
+            ret = LEPT_PARSE_MISS_KEY;
+            break;
+        }
+        m = lept_append_object_member(v, key, klen);
+        lept_parse_whitespace(c);
+        if (*c->json != ':') {
+            ret = LEPT_PARSE_MISS_COLON;
+            break;
+        }
+        c->json++;
+        lept_parse_whitespace(c);
+        if ((ret = lept_parse_value(c, m)) != LEPT_PARSE_OK)
+            break;
+        lept_parse_whitespace(c);
+        if (*c->json == ',') {
+            c->json++;
+            lept_parse_whitespace(c);
+        }
+        else if (*c->json == '}') {
+            c->json++;
+            c->hints->counts[slot] = v->u.o.size;
+            return LEPT_PARSE_OK;
+        }
+        else {
+            ret = LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            break;
+        }
+    }
+    v->lept_free();
+    return ret;
+}
+
 static int lept_parse_value(lept_context* c, lept_value* v) {
+    int ret;
     // check length
     switch (*c->json) {
         case 'n':  return lept_parse_literal(c, v, "null", LEPT_NULL);
@@ -317,99 +646,814 @@ static int lept_parse_value(lept_context* c, lept_value* v) {
         case 'f':  return lept_parse_literal(c, v, "false", LEPT_FALSE);
         case '"':  return lept_parse_string(c, v);
         case '\0': return LEPT_PARSE_EXPECT_VALUE;
-        case '[':  return lept_parse_array(c, v);
-        case '{':  return lept_parse_object(c, v);
+        case '[':
+            STAT_ADD(arrays, 1);
+            STAT_ENTER(c);
+            ret = c->hints ? lept_parse_array_sized(c, v) : lept_parse_array(c, v);
+            STAT_LEAVE(c);
+            return ret;
+        case '{':
+            STAT_ADD(objects, 1);
+            STAT_ENTER(c);
+            ret = c->hints ? lept_parse_object_sized(c, v) : lept_parse_object(c, v);
+            STAT_LEAVE(c);
+            return ret;
         default:   return lept_parse_number(c, v);
     }
 }
 
-int lept_value::lept_parse(const char* json) {
+int lept_value::lept_parse(const char* json, int flags, lept_size_hints* hints, lept_parse_stats* stats) {
     lept_context c;
     // assert(v != NULL);
+    if (stats)
+        memset(stats, 0, sizeof(lept_parse_stats));
+#ifdef LEPT_ENABLE_STATS
+    lept_stats = stats;
+    c.depth = 0;
+#endif
+    STAT_START(total);
     c.json = json;
+    c.flags = flags;
     c.stack = NULL;        /* <- */
     c.size = c.top = 0;    /* <- */
+    c.hints = hints;
+    c.container = 0;
+    c.end = hints ? json + strlen(json) : NULL;
     this->type = LEPT_NULL;
     lept_parse_whitespace(&c);
     int result = lept_parse_value(&c, this);
 
     if (result == LEPT_PARSE_OK) {
         lept_parse_whitespace(&c);
-        if (*c.json != '\0')
-            return LEPT_PARSE_ROOT_NOT_SINGULAR;
+        if (*c.json != '\0') {
+            this->lept_free();
+            result = LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
     }
+    if (c.hints && result == LEPT_PARSE_OK)
+        c.hints->size = c.container;
 
     assert(c.top == 0);    /* <- */
     free(c.stack);         /* <- */
+    STAT_ADD(bytes_scanned, (size_t)(c.json - json));
+    STAT_STOP(total_ns, total);
+#ifdef LEPT_ENABLE_STATS
+    lept_stats = NULL;
+#endif
     return result;
 }
 
-lept_type lept_value::lept_get_type() {
-    return type;
+lept_size_hints::~lept_size_hints() {
+    free(counts);
 }
 
-void lept_value::lept_free() {
-    if (this->type == LEPT_STRING) {
-        free(this->u.s.s);
-    }
-    if (this->type == LEPT_ARRAY) {
-        for (size_t i = 0; i < this->u.a.size; i++) {
-            this->u.a.e[i].lept_free();
+/* validation: the grammar checks of lept_parse over a bounded buffer, without building values */
+
+typedef struct {
+    const char* json;
+    const char* end;
+    unsigned char plain;    /* LEPT_CH_UTF8 passes non-ASCII bytes unchecked, as lept_parse does by default */
+} lept_validator;
+
+#define LEPT_SWAR_ONES  0x0101010101010101ULL
+#define LEPT_SWAR_HIGH  0x8080808080808080ULL
+/* nonzero if a byte of w is below n (n <= 0x80); may flag bytes after a true hit */
+#define SWAR_LESS(w, n) (((w) - LEPT_SWAR_ONES * (n)) & ~(w))
+#define SWAR_HAS(w, ch) SWAR_LESS((w) ^ (LEPT_SWAR_ONES * (ch)), 1)
+
+/* nonzero if the 8 bytes contain '"', '\\', a control character or a non-ASCII byte */
+static inline unsigned long long lept_swar_special(unsigned long long w) {
+    return (w | SWAR_LESS(w, 0x20) | SWAR_HAS(w, '\"') | SWAR_HAS(w, '\\')) & LEPT_SWAR_HIGH;
+}
+
+static void lept_validate_whitespace(lept_validator* c) {
+    const char* p = c->json;
+    while (p < c->end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    c->json = p;
+}
+
+/* check a hex4 escape inside the buffer */
+static const char* lept_validate_hex4(const char* p, const char* end, unsigned* u) {
+    if (end - p < 4)
+        return NULL;
+    return lept_parse_hex4(p, u);
+}
+
+static int lept_validate_string(lept_validator* c) {
+    const char* p = c->json + 1;
+    const char* end = c->end;
+    unsigned u, u2;
+    for (;;) {
+        /* skip ordinary characters 8 at a time, then one by one */
+        for (unsigned long long w; end - p >= 8; p += 8) {
+            memcpy(&w, p, 8);
+            if (lept_swar_special(w))
+                break;
+        }
+        while (p < end && lept_string_class[(unsigned char)*p] <= c->plain)
+            p++;
+        if (p == end)
+            return LEPT_PARSE_MISS_QUOTATION_MARK;
+        switch (lept_string_class[(unsigned char)*p++]) {
+            case LEPT_CH_QUOTE:
+                c->json = p;
+                return LEPT_PARSE_OK;
+            case LEPT_CH_END:
+                return LEPT_PARSE_MISS_QUOTATION_MARK;
+            case LEPT_CH_CTRL:
+                return LEPT_PARSE_INVALID_STRING_CHAR;
+            case LEPT_CH_UTF8: {
+                size_t n = lept_utf8_ranges[lept_utf8_lead[(unsigned char)p[-1] - 0x80]].len;
+                if (n == 0 || n - 1 > (size_t)(end - p) || lept_utf8_sequence(p - 1) != n)
+                    return LEPT_PARSE_INVALID_UTF8;
+                p += n - 1;
+                break;
+            }
+            case LEPT_CH_ESCAPE:
+                switch (PEEK(p, end)) {
+                    case '\"': case '\\': case '/':
+                    case 'b': case 'f': case 'n': case 'r': case 't':
+                        p++;
+                        break;
+                    case 'u':
+                        if (!(p = lept_validate_hex4(p + 1, end, &u)))
+                            return LEPT_PARSE_INVALID_UNICODE_HEX;
+                        if (u >= 0xD800 && u <= 0xDBFF) {
+                            if (PEEK(p, end) != '\\' || PEEK(p + 1, end) != 'u')
+                                return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                            if (!(p = lept_validate_hex4(p + 2, end, &u2)))
+                                return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                            if (!(u2 >= 0xDC00 && u2 <= 0xDFFF))
+                                return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                        }
+                        else if (u >= 0xDC00 && u <= 0xDFFF)
+                            return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                        break;
+                    default:
+                        return LEPT_PARSE_INVALID_STRING_ESCAPE;
+                }
+                break;
         }
-        free(this->u.a.e);
     }
-    if (this->type == LEPT_OBJECT) {
-        for (size_t i = 0; i < this->u.o.size; i++) {
-            free(this->u.o.m[i].k);
-            this->u.o.m[i].v.lept_free();
+}
+
+/* explicit exponents saturate here, far beyond what any mantissa held in memory can offset */
+#define LEPT_NUMBER_MAX_EXP     1000000000000000LL
+#define LEPT_NUMBER_EDGE_DIGITS 309     /* digits of DBL_MAX + half an ulp, the overflow boundary */
+
+/**
+ * check that the number in [p, end) fits a double, as strtod would decide
+ * only numbers within a factor of ten of DBL_MAX are handed to strtod, rebuilt in a bounded buffer
+ **/
+static int lept_validate_number_range(const char* p, const char* end) {
+    char buf[LEPT_NUMBER_EDGE_DIGITS + 16];
+    size_t digits = 0;
+    long long exp10 = 0, e = 0;     /* |exp10| is bounded by the mantissa length, e by LEPT_NUMBER_MAX_EXP */
+    int started = 0, fraction = 0;
+    if (*p == '-')
+        p++;    /* overflow is symmetric */
+    for (; p < end && *p != 'e' && *p != 'E'; p++) {
+        if (*p == '.') {
+            fraction = 1;
+            continue;
         }
-        free(this->u.o.m);
+        if (!started && *p == '0') {
+            if (fraction)
+                exp10--;
+            continue;
+        }
+        started = 1;
+        if (!fraction)
+            exp10++;
+        if (digits < LEPT_NUMBER_EDGE_DIGITS)
+            buf[2 + digits++] = *p;
     }
-    this->type = LEPT_NULL;
+    if (!started)
+        return LEPT_PARSE_OK;
+    if (p < end) {
+        int sign = 1;
+        if (*++p == '-' || *p == '+')
+            sign = *p++ == '-' ? -1 : 1;
+        for (; p < end; p++)
+            if (e < LEPT_NUMBER_MAX_EXP)
+                e = e * 10 + (*p - '0');
+        exp10 += sign * e;
+    }
+    /* the value is 0.d1d2... * 10^exp10 */
+    if (exp10 <= 308)
+        return LEPT_PARSE_OK;
+    if (exp10 > 309)
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    /* the first 309 significant digits decide which side of the boundary the value is on */
+    buf[0] = '0';
+    buf[1] = '.';
+    memcpy(buf + 2 + digits, "e309", 5);
+    errno = 0;
+    double n = strtod(buf, NULL);
+    if (errno == ERANGE && n == HUGE_VAL)
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    return LEPT_PARSE_OK;
 }
 
-int lept_value::lept_get_boolean() {
-    assert((this->type == LEPT_TRUE || this->type == LEPT_FALSE));
-    return this->type == LEPT_TRUE ? true : false;
+static int lept_validate_number(lept_validator* c) {
+    const char* end = lept_scan_number(c->json, c->end);
+    if (end == NULL)
+        return LEPT_PARSE_INVALID_VALUE;
+    int ret = lept_validate_number_range(c->json, end);
+    c->json = end;
+    return ret;
 }
 
-void lept_value::lept_set_boolean(int b) {
-    this->type = b > 0 ? LEPT_TRUE : LEPT_FALSE;
+static int lept_validate_literal(lept_validator* c, const char* str, size_t len) {
+    if ((size_t)(c->end - c->json) < len || memcmp(c->json, str, len) != 0)
+        return LEPT_PARSE_INVALID_VALUE;
+    c->json += len;
+    return LEPT_PARSE_OK;
 }
 
-double lept_value::lept_get_number() {
-    assert(this->type == LEPT_NUMBER);
-    return this->u.n;
+static int lept_validate_value(lept_validator* c);
+
+static int lept_validate_array(lept_validator* c) {
+    int ret;
+    c->json++;
+    lept_validate_whitespace(c);
+    if (PEEK(c->json, c->end) == ']') {
+        c->json++;
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        lept_validate_whitespace(c);
+        if ((ret = lept_validate_value(c)) != LEPT_PARSE_OK)
+            return ret;
+        lept_validate_whitespace(c);
+        switch (PEEK(c->json, c->end)) {
+            case ',': c->json++; break;
+            case ']': c->json++; return LEPT_PARSE_OK;
+            default:  return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+    }
 }
 
-void lept_value::lept_set_number(double n) {
-    this->u.n = n;
-    this->type = LEPT_NUMBER;
+static int lept_validate_object(lept_validator* c) {
+    int ret;
+    c->json++;
+    lept_validate_whitespace(c);
+    if (PEEK(c->json, c->end) == '}') {
+        c->json++;
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        if (PEEK(c->json, c->end) != '\"' || lept_validate_string(c) != LEPT_PARSE_OK)
+            return LEPT_PARSE_MISS_KEY;
+        lept_validate_whitespace(c);
+        if (PEEK(c->json, c->end) != ':')
+            return LEPT_PARSE_MISS_COLON;
+        c->json++;
+        lept_validate_whitespace(c);
+        if ((ret = lept_validate_value(c)) != LEPT_PARSE_OK)
+            return ret;
+        lept_validate_whitespace(c);
+        switch (PEEK(c->json, c->end)) {
+            case ',': c->json++; break;
+            case '}': c->json++; return LEPT_PARSE_OK;
+            default:  return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        }
+        lept_validate_whitespace(c);
+    }
 }
 
-const char* lept_value::lept_get_string() {
-    assert(this->type == LEPT_STRING);
-    return this->u.s.s;
+static int lept_validate_value(lept_validator* c) {
+    switch (PEEK(c->json, c->end)) {
+        case 'n':  return lept_validate_literal(c, "null", 4);
+        case 't':  return lept_validate_literal(c, "true", 4);
+        case 'f':  return lept_validate_literal(c, "false", 5);
+        case '"':  return lept_validate_string(c);
+        case '[':  return lept_validate_array(c);
+        case '{':  return lept_validate_object(c);
+        case '\0': return LEPT_PARSE_EXPECT_VALUE;
+        default:   return lept_validate_number(c);
+    }
 }
 
-size_t lept_value::lept_get_string_length() {
-    assert(this->type == LEPT_STRING);
-    return this->u.s.len;
+int lept_validate(const char* json, size_t len) {
+    lept_validator c;
+    assert(json != NULL || len == 0);
+    if (len == 0)
+        return LEPT_PARSE_EXPECT_VALUE;
+    c.json = json;
+    c.end = json + len;
+    c.plain = LEPT_CH_PLAIN;
+    lept_validate_whitespace(&c);
+    int ret = lept_validate_value(&c);
+    if (ret == LEPT_PARSE_OK) {
+        lept_validate_whitespace(&c);
+        if (c.json != c.end)
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+    return ret;
 }
 
-void lept_value::lept_set_string(const char* s, size_t len) {
-    assert((s != NULL || len == 0));
-    this->lept_free();
-    this->u.s.s = (char*)malloc(len + 1);
-    memcpy(this->u.s.s, s, len);
-    this->u.s.s[len] = '\0';
-    this->u.s.len = len;
-    this->type = LEPT_STRING;
+/* pull reader: one token at a time, on top of the parser's scanners */
+
+lept_reader::lept_reader(const char* json, int flags) {
+    assert(json != NULL);
+    c = (lept_context*)malloc(sizeof(lept_context));
+    c->json = json;
+    c->stack = NULL;
+    c->size = c->top = 0;
+    c->flags = flags;
+    c->hints = NULL;
+    c->container = 0;
+#ifdef LEPT_ENABLE_STATS
+    c->depth = 0;
+#endif
+    end = json + strlen(json);
 }
 
-size_t lept_value::lept_get_array_size() {
-    assert(this->type == LEPT_ARRAY);
-    return this->u.a.size;
+lept_reader::~lept_reader() {
+    free(c->stack);
+    free(c);
+}
+
+int lept_reader::lept_peek(lept_type* type) {
+    lept_parse_whitespace(c);
+    switch (*c->json) {
+        case 'n':  *type = LEPT_NULL; break;
+        case 't':  *type = LEPT_TRUE; break;
+        case 'f':  *type = LEPT_FALSE; break;
+        case '"':  *type = LEPT_STRING; break;
+        case '[':  *type = LEPT_ARRAY; break;
+        case '{':  *type = LEPT_OBJECT; break;
+        case '\0': return LEPT_PARSE_EXPECT_VALUE;
+        default:   *type = LEPT_NUMBER; break;
+    }
+    return LEPT_PARSE_OK;
+}
+
+int lept_reader::lept_read_null() {
+    lept_value v;
+    lept_parse_whitespace(c);
+    return lept_parse_literal(c, &v, "null", LEPT_NULL);
+}
+
+int lept_reader::lept_read_boolean(int* b) {
+    lept_value v;
+    int ret;
+    lept_parse_whitespace(c);
+    if (*c->json == 't')
+        ret = lept_parse_literal(c, &v, "true", LEPT_TRUE);
+    else
+        ret = lept_parse_literal(c, &v, "false", LEPT_FALSE);
+    *b = v.type == LEPT_TRUE;
+    return ret;
+}
+
+int lept_reader::lept_read_number(double* n) {
+    const char* s;
+    size_t len;
+    return lept_read_number(n, &s, &len);
+}
+
+int lept_reader::lept_read_number(double* n, const char** s, size_t* len) {
+    lept_value v;
+    int ret;
+    lept_parse_whitespace(c);
+    const char* start = c->json;
+    if ((ret = lept_parse_number(c, &v)) == LEPT_PARSE_OK) {
+        *n = v.u.n;
+        *s = start;
+        *len = (size_t)(c->json - start);
+    }
+    return ret;
+}
+
+int lept_reader::lept_read_string(const char** s, size_t* len) {
+    char* str;
+    int ret;
+    lept_parse_whitespace(c);
+    if (*c->json != '\"')
+        return LEPT_PARSE_INVALID_VALUE;
+    /* the popped characters stay in the stack until the next push */
+    if ((ret = lept_parse_string_raw(c, &str, len)) == LEPT_PARSE_OK)
+        *s = str;
+    return ret;
+}
+
+int lept_reader::lept_read_array(int* more) {
+    lept_parse_whitespace(c);
+    if (*c->json != '[')
+        return LEPT_PARSE_INVALID_VALUE;
+    c->json++;
+    lept_parse_whitespace(c);
+    if ((*more = *c->json != ']') == 0)
+        c->json++;
+    return LEPT_PARSE_OK;
+}
+
+int lept_reader::lept_read_array_next(int* more) {
+    lept_parse_whitespace(c);
+    switch (*c->json) {
+        case ',': *more = 1; break;
+        case ']': *more = 0; break;
+        default:  return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+    }
+    c->json++;
+    return LEPT_PARSE_OK;
+}
+
+int lept_reader::lept_read_object(int* more) {
+    lept_parse_whitespace(c);
+    if (*c->json != '{')
+        return LEPT_PARSE_INVALID_VALUE;
+    c->json++;
+    lept_parse_whitespace(c);
+    if ((*more = *c->json != '}') == 0)
+        c->json++;
+    return LEPT_PARSE_OK;
+}
+
+int lept_reader::lept_read_object_key(const char** k, size_t* klen) {
+    char* str;
+    lept_parse_whitespace(c);
+    if (*c->json != '\"' || lept_parse_string_raw(c, &str, klen) != LEPT_PARSE_OK)
+        return LEPT_PARSE_MISS_KEY;
+    *k = str;
+    lept_parse_whitespace(c);
+    if (*c->json != ':')
+        return LEPT_PARSE_MISS_COLON;
+    c->json++;
+    return LEPT_PARSE_OK;
+}
+
+int lept_reader::lept_read_object_next(int* more) {
+    lept_parse_whitespace(c);
+    switch (*c->json) {
+        case ',': *more = 1; break;
+        case '}': *more = 0; break;
+        default:  return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    }
+    c->json++;
+    return LEPT_PARSE_OK;
+}
+
+int lept_reader::lept_skip() {
+    lept_validator v;
+    int ret;
+    lept_parse_whitespace(c);
+    v.json = c->json;
+    v.end = end;
+    v.plain = (c->flags & LEPT_PARSE_STRICT_UTF8) ? LEPT_CH_PLAIN : LEPT_CH_UTF8;
+    if ((ret = lept_validate_value(&v)) == LEPT_PARSE_OK)
+        c->json = v.json;
+    return ret;
+}
+
+int lept_reader::lept_read_end() {
+    lept_parse_whitespace(c);
+    return *c->json == '\0' ? LEPT_PARSE_OK : LEPT_PARSE_ROOT_NOT_SINGULAR;
+}
+
+/* stream parser: the parse loop runs on an explicit container stack, tokens are scanned once complete */
+
+enum {
+    LEPT_STREAM_VALUE,
+    LEPT_STREAM_ARRAY_FIRST,    /* after '[' */
+    LEPT_STREAM_ARRAY_NEXT,     /* after an element */
+    LEPT_STREAM_OBJECT_FIRST,   /* after '{' */
+    LEPT_STREAM_OBJECT_KEY,     /* after ',' */
+    LEPT_STREAM_OBJECT_COLON,   /* after a key */
+    LEPT_STREAM_OBJECT_NEXT,    /* after a member value */
+    LEPT_STREAM_ROOT_DONE,
+    LEPT_STREAM_FINISHED
+};
+
+struct lept_stream_state {
+    lept_context c;             /* c.json points into buf while a token is scanned */
+    char* buf;                  /* unconsumed input is buf[pos, len), buf[len] is '\0' */
+    size_t pos, len, cap;
+    size_t scan;                /* bytes after pos known not to close the pending string */
+    int escaped;                /* the last scanned byte of the pending string is a backslash */
+    int state, finished, result;
+    lept_value* root;
+    lept_value* target;         /* where the next value goes */
+    lept_value** frames;        /* open containers, innermost last */
+    size_t depth, frames_cap;
+};
+
+/* a token needs all its bytes; at the end of input the '\0' after them ends it */
+static int lept_stream_string_ready(lept_stream_state* s) {
+    size_t i = s->pos + (s->scan ? s->scan : 1);
+    int escaped = s->escaped;
+    for (; i < s->len; i++) {
+        char ch = s->buf[i];
+        if (ch == '\0')
+            break;
+        if (escaped)
+            escaped = 0;
+        else if (ch == '\\')
+            escaped = 1;
+        else if (ch == '\"')
+            break;
+    }
+    if (i == s->len && !s->finished) {
+        s->scan = i - s->pos;
+        s->escaped = escaped;
+        return 0;
+    }
+    s->scan = 0;
+    s->escaped = 0;
+    return 1;
+}
+
+static int lept_stream_number_ready(lept_stream_state* s) {
+    size_t i = s->pos;
+    for (; i < s->len; i++) {
+        char ch = s->buf[i];
+        if (!ISDIGIT(ch) && ch != '+' && ch != '-' && ch != '.' && ch != 'e' && ch != 'E')
+            break;
+    }
+    return i < s->len || s->finished;
+}
+
+/* the target became an empty container, its elements follow */
+static void lept_stream_open(lept_stream_state* s, int state) {
+    if (s->depth == s->frames_cap) {
+        s->frames_cap = s->frames_cap == 0 ? 16 : s->frames_cap * 2;
+        s->frames = (lept_value**)realloc(s->frames, s->frames_cap * sizeof(lept_value*));
+    }
+    s->frames[s->depth++] = s->target;
+    s->pos++;
+    s->state = state;
+}
+
+/* a value is complete, continue in its container */
+static void lept_stream_complete(lept_stream_state* s) {
+    if (s->depth == 0)
+        s->state = LEPT_STREAM_ROOT_DONE;
+    else
+        s->state = s->frames[s->depth - 1]->type == LEPT_ARRAY ? LEPT_STREAM_ARRAY_NEXT : LEPT_STREAM_OBJECT_NEXT;
+}
+
+/* run a scanner of the parser on the token at pos, once at least need bytes are buffered */
+#define STREAM_SCAN(s, need, call) \
+    do {\
+        if ((s)->len - (s)->pos < (need) && !(s)->finished)\
+            return LEPT_PARSE_INCOMPLETE;\
+        (s)->c.json = (s)->buf + (s)->pos;\
+        if ((ret = (call)) != LEPT_PARSE_OK)\
+            return ret;\
+        (s)->pos = (s)->c.json - (s)->buf;\
+    } while(0)
+
+static int lept_stream_value(lept_stream_state* s) {
+    int ret;
+    switch (s->buf[s->pos]) {
+        case 'n':  STREAM_SCAN(s, 4, lept_parse_literal(&s->c, s->target, "null", LEPT_NULL)); break;
+        case 't':  STREAM_SCAN(s, 4, lept_parse_literal(&s->c, s->target, "true", LEPT_TRUE)); break;
+        case 'f':  STREAM_SCAN(s, 5, lept_parse_literal(&s->c, s->target, "false", LEPT_FALSE)); break;
+        case '"':
+            if (!lept_stream_string_ready(s))
+                return LEPT_PARSE_INCOMPLETE;
+            STREAM_SCAN(s, 0, lept_parse_string(&s->c, s->target));
+            break;
+        case '[':
+            s->target->lept_set_array(0);
+            lept_stream_open(s, LEPT_STREAM_ARRAY_FIRST);
+            return LEPT_PARSE_OK;
+        case '{':
+            s->target->lept_set_object(0);
+            lept_stream_open(s, LEPT_STREAM_OBJECT_FIRST);
+            return LEPT_PARSE_OK;
+        case '\0':
+            return LEPT_PARSE_EXPECT_VALUE;
+        default:
+            if (!lept_stream_number_ready(s))
+                return LEPT_PARSE_INCOMPLETE;
+            STREAM_SCAN(s, 0, lept_parse_number(&s->c, s->target));
+            break;
+    }
+    lept_stream_complete(s);
+    return LEPT_PARSE_OK;
+}
+
+/* advance as far as the input allows, the same steps as lept_parse_value() and its helpers */
+static int lept_stream_run(lept_stream_state* s) {
+    char* str;
+    size_t klen;
+    int ret;
+    for (;;) {
+        while (s->pos < s->len && (s->buf[s->pos] == ' ' || s->buf[s->pos] == '\t' ||
+               s->buf[s->pos] == '\n' || s->buf[s->pos] == '\r'))
+            s->pos++;
+        if (s->pos == s->len && !s->finished)
+            return LEPT_PARSE_INCOMPLETE;
+        lept_value* top = s->depth ? s->frames[s->depth - 1] : NULL;
+        char ch = s->buf[s->pos];
+        switch (s->state) {
+            case LEPT_STREAM_VALUE:
+                if ((ret = lept_stream_value(s)) != LEPT_PARSE_OK)
+                    return ret;
+                break;
+            case LEPT_STREAM_ARRAY_FIRST:
+            case LEPT_STREAM_ARRAY_NEXT:
+                if (ch == ']') {
+                    s->pos++;
+                    s->depth--;
+                    lept_stream_complete(s);
+                }
+                else if (s->state == LEPT_STREAM_ARRAY_FIRST || ch == ',') {
+                    s->pos += s->state == LEPT_STREAM_ARRAY_NEXT;
+                    s->target = top->lept_pushback_array_element();
+                    s->state = LEPT_STREAM_VALUE;
+                }
+                else
+                    return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                break;
+            case LEPT_STREAM_OBJECT_FIRST:
+            case LEPT_STREAM_OBJECT_NEXT:
+                if (ch == '}') {
+                    s->pos++;
+                    s->depth--;
+                    lept_stream_complete(s);
+                }
+                else if (s->state == LEPT_STREAM_OBJECT_FIRST || ch == ',') {
+                    s->pos += s->state == LEPT_STREAM_OBJECT_NEXT;
+                    s->state = LEPT_STREAM_OBJECT_KEY;
+                }
+                else
+                    return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                break;
+            case LEPT_STREAM_OBJECT_KEY:
+                if (ch != '\"')
+                    return LEPT_PARSE_MISS_KEY;
+                if (!lept_stream_string_ready(s))
+                    return LEPT_PARSE_INCOMPLETE;
+                s->c.json = s->buf + s->pos;
+                if (lept_parse_string_raw(&s->c, &str, &klen) != LEPT_PARSE_OK)
+                    return LEPT_PARSE_MISS_KEY;
+                s->pos = s->c.json - s->buf;
+                s->target = lept_append_object_member(top, str, klen);
+                s->state = LEPT_STREAM_OBJECT_COLON;
+                break;
+            case LEPT_STREAM_OBJECT_COLON:
+                if (ch != ':')
+                    return LEPT_PARSE_MISS_COLON;
+                s->pos++;
+                s->state = LEPT_STREAM_VALUE;
+                break;
+            case LEPT_STREAM_ROOT_DONE:
+                /* like lept_parse(), a NUL byte ends the document */
+                return ch == '\0' ? LEPT_PARSE_OK : LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+}
+
+/* record the outcome once it is known */
+static int lept_stream_result(lept_stream_state* s, int ret) {
+    if (ret == LEPT_PARSE_INCOMPLETE)
+        return ret;
+    if (ret != LEPT_PARSE_OK)
+        s->root->lept_free();
+    assert(s->c.top == 0);
+    s->state = LEPT_STREAM_FINISHED;
+    s->result = ret;
+    return ret;
+}
+
+lept_stream_parser::lept_stream_parser(lept_value* v, int flags) {
+    assert(v != NULL);
+    s = (lept_stream_state*)malloc(sizeof(lept_stream_state));
+    s->c.json = NULL;
+    s->c.stack = NULL;
+    s->c.size = s->c.top = 0;
+    s->c.flags = flags;
+    s->c.hints = NULL;
+    s->c.container = 0;
+#ifdef LEPT_ENABLE_STATS
+    s->c.depth = 0;
+#endif
+    s->buf = NULL;
+    s->pos = s->len = s->cap = 0;
+    s->scan = 0;
+    s->escaped = 0;
+    s->state = LEPT_STREAM_VALUE;
+    s->finished = 0;
+    s->result = LEPT_PARSE_INCOMPLETE;
+    s->root = s->target = v;
+    s->frames = NULL;
+    s->depth = s->frames_cap = 0;
+    v->type = LEPT_NULL;
+}
+
+lept_stream_parser::~lept_stream_parser() {
+    /* an unfinished value is not handed out */
+    if (s->state != LEPT_STREAM_FINISHED)
+        s->root->lept_free();
+    free(s->c.stack);
+    free(s->buf);
+    free(s->frames);
+    free(s);
+}
+
+int lept_stream_parser::lept_feed(const char* data, size_t len) {
+    assert(data != NULL || len == 0);
+    if (s->state == LEPT_STREAM_FINISHED)
+        return s->result;
+    /* keep only the unconsumed bytes, a pending token moves at most once */
+    if (s->pos > 0) {
+        memmove(s->buf, s->buf + s->pos, s->len - s->pos);
+        s->len -= s->pos;
+        s->pos = 0;
+    }
+    if (s->len + len + 1 > s->cap) {
+        s->cap = s->cap == 0 ? LEPT_PARSE_STACK_INIT_SIZE : s->cap;
+        while (s->len + len + 1 > s->cap)
+            s->cap += s->cap >> 1;
+        s->buf = (char*)realloc(s->buf, s->cap);
+    }
+    if (len > 0)
+        memcpy(s->buf + s->len, data, len);
+    s->len += len;
+    s->buf[s->len] = '\0';
+    return lept_stream_result(s, lept_stream_run(s));
+}
+
+int lept_stream_parser::lept_finish() {
+    if (s->state == LEPT_STREAM_FINISHED)
+        return s->result;
+    s->finished = 1;
+    return lept_feed(NULL, 0);
+}
+
+lept_type lept_value::lept_get_type() {
+    return type;
+}
+
+void lept_value::lept_free() {
+    if (this->type == LEPT_STRING && !this->borrowed) {
+        free(this->u.s.s);
+    }
+    if (this->type == LEPT_ARRAY) {
+        for (size_t i = 0; i < this->u.a.size; i++) {
+            this->u.a.e[i].lept_free();
+        }
+        free(this->u.a.e);
+    }
+    if (this->type == LEPT_OBJECT) {
+        for (size_t i = 0; i < this->u.o.size; i++) {
+            free(this->u.o.m[i].k);
+            this->u.o.m[i].v.lept_free();
+        }
+        free(this->u.o.m);
+    }
+    this->type = LEPT_NULL;
+    this->borrowed = 0;
+}
+
+int lept_value::lept_get_boolean() {
+    assert((this->type == LEPT_TRUE || this->type == LEPT_FALSE));
+    return this->type == LEPT_TRUE ? true : false;
+}
+
+void lept_value::lept_set_boolean(int b) {
+    this->type = b > 0 ? LEPT_TRUE : LEPT_FALSE;
+}
+
+double lept_value::lept_get_number() {
+    assert(this->type == LEPT_NUMBER);
+    return this->u.n;
+}
+
+void lept_value::lept_set_number(double n) {
+    this->u.n = n;
+    this->type = LEPT_NUMBER;
+}
+
+const char* lept_value::lept_get_string() {
+    assert(this->type == LEPT_STRING);
+    return this->u.s.s;
+}
+
+size_t lept_value::lept_get_string_length() {
+    assert(this->type == LEPT_STRING);
+    return this->u.s.len;
+}
+
+void lept_value::lept_set_string(const char* s, size_t len) {
+    assert((s != NULL || len == 0));
+    this->lept_free();
+    this->u.s.s = (char*)lept_malloc(len + 1);
+    if (len > 0)
+        memcpy(this->u.s.s, s, len);
+    this->u.s.s[len] = '\0';
+    this->u.s.len = len;
+    this->type = LEPT_STRING;
+}
+
+size_t lept_value::lept_get_array_size() {
+    assert(this->type == LEPT_ARRAY);
+    return this->u.a.size;
 }
 
 lept_value* lept_value::lept_get_array_element(size_t index) {
@@ -441,4 +1485,1230 @@ lept_value* lept_value::lept_get_object_value(size_t index) {
     return &this->u.o.m[index].v;
 }
 
+size_t lept_value::lept_find_object_index(const char* key, size_t klen) {
+    assert(this->type == LEPT_OBJECT && (key != NULL || klen == 0));
+    for (size_t i = 0; i < this->u.o.size; i++)
+        if (this->u.o.m[i].klen == klen && memcmp(this->u.o.m[i].k, key, klen) == 0)
+            return i;
+    return LEPT_KEY_NOT_EXIST;
+}
+
+lept_value* lept_value::lept_find_object_value(const char* key, size_t klen) {
+    size_t index = lept_find_object_index(key, klen);
+    return index != LEPT_KEY_NOT_EXIST ? &this->u.o.m[index].v : NULL;
+}
+
+void lept_value::lept_copy(lept_value* src) {
+    assert(src != NULL && src != this);
+    switch (src->type) {
+        case LEPT_STRING:
+            lept_set_string(src->u.s.s, src->u.s.len);
+            break;
+        case LEPT_ARRAY:
+            lept_set_array(src->u.a.size);
+            for (size_t i = 0; i < src->u.a.size; i++)
+                lept_pushback_array_element()->lept_copy(&src->u.a.e[i]);
+            break;
+        case LEPT_OBJECT:
+            lept_set_object(src->u.o.size);
+            for (size_t i = 0; i < src->u.o.size; i++)
+                lept_append_object_member(this, src->u.o.m[i].k, src->u.o.m[i].klen)->lept_copy(&src->u.o.m[i].v);
+            break;
+        default:
+            lept_free();
+            memcpy(this, src, sizeof(lept_value));
+            break;
+    }
+}
+
+void lept_value::lept_move(lept_value* src) {
+    assert(src != NULL && src != this);
+    lept_free();
+    memcpy(this, src, sizeof(lept_value));
+    *src = lept_value();
+}
+
+void lept_value::lept_swap(lept_value* rhs) {
+    assert(rhs != NULL);
+    if (this != rhs) {
+        lept_value temp;
+        memcpy(&temp, this, sizeof(lept_value));
+        memcpy(this,  rhs,  sizeof(lept_value));
+        memcpy(rhs, &temp, sizeof(lept_value));
+    }
+}
+
+void lept_value::lept_set_array(size_t capacity) {
+    lept_free();
+    this->type = LEPT_ARRAY;
+    this->u.a.size = 0;
+    this->u.a.capacity = capacity;
+    this->u.a.e = capacity > 0 ? (lept_value*)lept_malloc(capacity * sizeof(lept_value)) : NULL;
+}
+
+size_t lept_value::lept_get_array_capacity() {
+    assert(this->type == LEPT_ARRAY);
+    return this->u.a.capacity;
+}
+
+void lept_value::lept_reserve_array(size_t capacity) {
+    assert(this->type == LEPT_ARRAY);
+    if (this->u.a.capacity < capacity) {
+        this->u.a.capacity = capacity;
+        this->u.a.e = (lept_value*)lept_realloc(this->u.a.e, capacity * sizeof(lept_value));
+    }
+}
+
+lept_value* lept_value::lept_pushback_array_element() {
+    assert(this->type == LEPT_ARRAY);
+    if (this->u.a.size == this->u.a.capacity)
+        lept_reserve_array(this->u.a.capacity == 0 ? 1 : this->u.a.capacity * 2);
+    lept_value* e = &this->u.a.e[this->u.a.size++];
+    *e = lept_value();
+    return e;
+}
+
+lept_value* lept_value::lept_insert_array_element(size_t index) {
+    assert(this->type == LEPT_ARRAY && index <= this->u.a.size);
+    if (this->u.a.size == this->u.a.capacity)
+        lept_reserve_array(this->u.a.capacity == 0 ? 1 : this->u.a.capacity * 2);
+    memmove(&this->u.a.e[index + 1], &this->u.a.e[index], (this->u.a.size - index) * sizeof(lept_value));
+    this->u.a.size++;
+    this->u.a.e[index] = lept_value();
+    return &this->u.a.e[index];
+}
+
+void lept_value::lept_erase_array_element(size_t index, size_t count) {
+    assert(this->type == LEPT_ARRAY && index + count <= this->u.a.size);
+    for (size_t i = index; i < index + count; i++)
+        this->u.a.e[i].lept_free();
+    memmove(&this->u.a.e[index], &this->u.a.e[index + count], (this->u.a.size - index - count) * sizeof(lept_value));
+    this->u.a.size -= count;
+}
+
+void lept_value::lept_set_object(size_t capacity) {
+    lept_free();
+    this->type = LEPT_OBJECT;
+    this->u.o.size = 0;
+    this->u.o.capacity = capacity;
+    this->u.o.m = capacity > 0 ? (lept_member*)lept_malloc(capacity * sizeof(lept_member)) : NULL;
+}
+
+size_t lept_value::lept_get_object_capacity() {
+    assert(this->type == LEPT_OBJECT);
+    return this->u.o.capacity;
+}
+
+void lept_value::lept_reserve_object(size_t capacity) {
+    assert(this->type == LEPT_OBJECT);
+    if (this->u.o.capacity < capacity) {
+        this->u.o.capacity = capacity;
+        this->u.o.m = (lept_member*)lept_realloc(this->u.o.m, capacity * sizeof(lept_member));
+    }
+}
+
+lept_value* lept_value::lept_set_object_value(const char* key, size_t klen) {
+    size_t index = lept_find_object_index(key, klen);
+    if (index != LEPT_KEY_NOT_EXIST)
+        return &this->u.o.m[index].v;
+    return lept_append_object_member(this, key, klen);
+}
+
+void lept_value::lept_remove_object_value(size_t index) {
+    assert(this->type == LEPT_OBJECT && index < this->u.o.size);
+    free(this->u.o.m[index].k);
+    this->u.o.m[index].v.lept_free();
+    memmove(&this->u.o.m[index], &this->u.o.m[index + 1], (this->u.o.size - index - 1) * sizeof(lept_member));
+    this->u.o.size--;
+}
+
+/* objects up to this size are matched by linear search in lept_is_equal() */
+#ifndef LEPT_OBJECT_INDEX_MIN_SIZE
+#define LEPT_OBJECT_INDEX_MIN_SIZE 16
+#endif
+
+#define LEPT_HASH_SEED 0xcbf29ce484222325ULL    /* FNV-1a offset basis */
+
+/* splitmix64 finalizer */
+static unsigned long long lept_hash_mix(unsigned long long h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/* FNV-1a */
+static unsigned long long lept_hash_bytes(const char* s, size_t len) {
+    unsigned long long h = LEPT_HASH_SEED;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static unsigned long long lept_hash_value(const lept_value* v) {
+    unsigned long long h = lept_hash_mix(LEPT_HASH_SEED + v->type);
+    switch (v->type) {
+        case LEPT_NUMBER: {
+            unsigned long long bits;
+            double n = v->u.n == 0.0 ? 0.0 : v->u.n;    /* -0.0 == 0.0 */
+            memcpy(&bits, &n, sizeof(bits));
+            return lept_hash_mix(h ^ bits);
+        }
+        case LEPT_STRING:
+            return lept_hash_mix(h ^ lept_hash_bytes(v->u.s.s, v->u.s.len));
+        case LEPT_ARRAY:
+            h = lept_hash_mix(h ^ v->u.a.size);
+            for (size_t i = 0; i < v->u.a.size; i++)
+                h = lept_hash_mix(h ^ lept_hash_value(&v->u.a.e[i]));
+            return h;
+        case LEPT_OBJECT: {
+            /* members are summed so that their order does not matter, duplicates count as lept_is_equal() counts them */
+            unsigned long long sum = 0;
+            for (size_t i = 0; i < v->u.o.size; i++) {
+                const lept_member* m = &v->u.o.m[i];
+                sum += lept_hash_mix(lept_hash_bytes(m->k, m->klen) ^ (lept_hash_value(&m->v) * 31));
+            }
+            return lept_hash_mix(h ^ v->u.o.size ^ sum);
+        }
+        default:
+            return h;
+    }
+}
+
+size_t lept_value::lept_hash() {
+    return (size_t)lept_hash_value(this);
+}
+
+/* open addressing table of member indices, for lookups in large objects */
+typedef struct {
+    size_t* slots;      /* member index + 1, 0 for an empty slot */
+    size_t mask;
+} lept_member_index;
+
+static void lept_member_index_init(lept_member_index* idx, const lept_value* o) {
+    size_t cap = 8;
+    assert(o->type == LEPT_OBJECT);
+    while (cap < o->u.o.size * 2)
+        cap <<= 1;
+    idx->mask = cap - 1;
+    idx->slots = (size_t*)calloc(cap, sizeof(size_t));
+    for (size_t i = 0; i < o->u.o.size; i++) {
+        size_t s = (size_t)lept_hash_bytes(o->u.o.m[i].k, o->u.o.m[i].klen) & idx->mask;
+        while (idx->slots[s] != 0)
+            s = (s + 1) & idx->mask;
+        idx->slots[s] = i + 1;
+    }
+}
+
+static size_t lept_member_index_find(const lept_member_index* idx, const lept_value* o, const char* k, size_t klen) {
+    size_t s = (size_t)lept_hash_bytes(k, klen) & idx->mask;
+    for (; idx->slots[s] != 0; s = (s + 1) & idx->mask) {
+        const lept_member* m = &o->u.o.m[idx->slots[s] - 1];
+        if (m->klen == klen && memcmp(m->k, k, klen) == 0)
+            return idx->slots[s] - 1;
+    }
+    return LEPT_KEY_NOT_EXIST;
+}
+
+static void lept_member_index_free(lept_member_index* idx) {
+    free(idx->slots);
+}
+
+/* the first member of o not yet used with the key and value of m, for objects with duplicate keys */
+static size_t lept_match_member(lept_value* o, const unsigned char* used, lept_member* m) {
+    for (size_t i = 0; i < o->u.o.size; i++) {
+        lept_member* n = &o->u.o.m[i];
+        if (!used[i] && n->klen == m->klen && memcmp(n->k, m->k, m->klen) == 0 && m->v.lept_is_equal(&n->v))
+            return i;
+    }
+    return LEPT_KEY_NOT_EXIST;
+}
+
+int lept_value::lept_is_equal(lept_value* rhs) {
+    assert(rhs != NULL);
+    if (this->type != rhs->type)
+        return 0;
+    switch (this->type) {
+        case LEPT_STRING:
+            return this->u.s.len == rhs->u.s.len &&
+                memcmp(this->u.s.s, rhs->u.s.s, this->u.s.len) == 0;
+        case LEPT_NUMBER:
+            return this->u.n == rhs->u.n;
+        case LEPT_ARRAY:
+            if (this->u.a.size != rhs->u.a.size)
+                return 0;
+            for (size_t i = 0; i < this->u.a.size; i++)
+                if (!this->u.a.e[i].lept_is_equal(&rhs->u.a.e[i]))
+                    return 0;
+            return 1;
+        case LEPT_OBJECT: {
+            if (this->u.o.size != rhs->u.o.size)
+                return 0;
+            /* every rhs member is matched at most once, so duplicate keys compare as a multiset */
+            lept_member_index idx;
+            unsigned char small_used[LEPT_OBJECT_INDEX_MIN_SIZE] = { 0 };
+            int large = rhs->u.o.size >= LEPT_OBJECT_INDEX_MIN_SIZE;
+            unsigned char* used = large ? (unsigned char*)calloc(rhs->u.o.size, 1) : small_used;
+            int equal = 1;
+            if (large)
+                lept_member_index_init(&idx, rhs);
+            for (size_t i = 0; i < this->u.o.size && equal; i++) {
+                lept_member* m = &this->u.o.m[i];
+                size_t index = large ? lept_member_index_find(&idx, rhs, m->k, m->klen)
+                                     : rhs->lept_find_object_index(m->k, m->klen);
+                if (index != LEPT_KEY_NOT_EXIST && (used[index] || !m->v.lept_is_equal(&rhs->u.o.m[index].v)))
+                    index = lept_match_member(rhs, used, m);
+                if ((equal = index != LEPT_KEY_NOT_EXIST))
+                    used[index] = 1;
+            }
+            if (large) {
+                lept_member_index_free(&idx);
+                free(used);
+            }
+            return equal;
+        }
+        default:
+            return 1;
+    }
+}
+
+/* RFC 6901 JSON pointer */
+
+/**
+ * read one reference token and unescape it into c->stack
+ * @param p pointer to the '/' that starts the token
+ * @return pointer to the next '/' or end, or NULL on an invalid escape
+ **/
+static const char* lept_pointer_token(lept_context* c, const char* p, const char* end) {
+    assert(*p == '/');
+    c->top = 0;
+    for (p++; p < end && *p != '/'; p++) {
+        if (*p != '~')
+            PUTC(c, *p);
+        else if (p + 1 < end && (p[1] == '0' || p[1] == '1'))
+            PUTC(c, *++p == '0' ? '~' : '/');
+        else
+            return NULL;
+    }
+    return p;
+}
+
+/* array index token: "0" or digits without a leading zero, "-" gives size */
+static size_t lept_pointer_index(lept_value* a, const char* tok, size_t len) {
+    size_t index = 0;
+    if (len == 1 && tok[0] == '-')
+        return a->u.a.size;
+    if (len == 0 || len > 18 || (tok[0] == '0' && len > 1))
+        return LEPT_KEY_NOT_EXIST;
+    for (size_t i = 0; i < len; i++) {
+        if (!ISDIGIT(tok[i]))
+            return LEPT_KEY_NOT_EXIST;
+        index = index * 10 + (tok[i] - '0');
+    }
+    return index;
+}
+
+static lept_value* lept_pointer_child(lept_value* v, const char* tok, size_t len) {
+    if (v->type == LEPT_OBJECT)
+        return v->lept_find_object_value(tok, len);
+    if (v->type == LEPT_ARRAY) {
+        size_t index = lept_pointer_index(v, tok, len);
+        return index < v->u.a.size ? &v->u.a.e[index] : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * resolve every token of a pointer but the last one
+ * @param parent container holding the target, NULL for the root pointer ""
+ * @return LEPT_PATCH_OK with the last token left in c->stack[0, c->top)
+ **/
+static int lept_pointer_resolve_parent(lept_context* c, lept_value* doc, lept_value* ptr, lept_value** parent) {
+    const char* p = ptr->u.s.s;
+    const char* end = p + ptr->u.s.len;
+    *parent = NULL;
+    if (p == end)
+        return LEPT_PATCH_OK;
+    if (*p != '/')
+        return LEPT_PATCH_INVALID_POINTER;
+    for (lept_value* v = doc;;) {
+        if (!(p = lept_pointer_token(c, p, end)))
+            return LEPT_PATCH_INVALID_POINTER;
+        if (p == end) {
+            *parent = v;
+            return LEPT_PATCH_OK;
+        }
+        if (!(v = lept_pointer_child(v, c->stack, c->top)))
+            return LEPT_PATCH_PATH_NOT_FOUND;
+    }
+}
+
+static int lept_pointer_resolve(lept_context* c, lept_value* doc, lept_value* ptr, lept_value** target) {
+    lept_value* parent;
+    int ret = lept_pointer_resolve_parent(c, doc, ptr, &parent);
+    if (ret != LEPT_PATCH_OK)
+        return ret;
+    *target = parent ? lept_pointer_child(parent, c->stack, c->top) : doc;
+    return *target ? LEPT_PATCH_OK : LEPT_PATCH_PATH_NOT_FOUND;
+}
+
+/* RFC 6902 JSON patch */
+
+/* move value into the location named by path (the "add" operation) */
+static int lept_patch_add(lept_context* c, lept_value* doc, lept_value* path, lept_value* value) {
+    lept_value* parent;
+    int ret = lept_pointer_resolve_parent(c, doc, path, &parent);
+    if (ret != LEPT_PATCH_OK)
+        return ret;
+    if (parent == NULL)
+        doc->lept_move(value);
+    else if (parent->type == LEPT_OBJECT)
+        parent->lept_set_object_value(c->stack, c->top)->lept_move(value);
+    else if (parent->type == LEPT_ARRAY) {
+        size_t index = lept_pointer_index(parent, c->stack, c->top);
+        if (index > parent->u.a.size)
+            return LEPT_PATCH_PATH_NOT_FOUND;
+        parent->lept_insert_array_element(index)->lept_move(value);
+    }
+    else
+        return LEPT_PATCH_PATH_NOT_FOUND;
+    return LEPT_PATCH_OK;
+}
+
+/* detach the value named by path into value (the "remove" operation) */
+static int lept_patch_remove(lept_context* c, lept_value* doc, lept_value* path, lept_value* value) {
+    lept_value* parent;
+    int ret = lept_pointer_resolve_parent(c, doc, path, &parent);
+    if (ret != LEPT_PATCH_OK)
+        return ret;
+    if (parent == NULL)
+        return LEPT_PATCH_INVALID_POINTER;     /* the root cannot be removed */
+    if (parent->type == LEPT_OBJECT) {
+        size_t index = parent->lept_find_object_index(c->stack, c->top);
+        if (index == LEPT_KEY_NOT_EXIST)
+            return LEPT_PATCH_PATH_NOT_FOUND;
+        value->lept_move(&parent->u.o.m[index].v);
+        parent->lept_remove_object_value(index);
+    }
+    else if (parent->type == LEPT_ARRAY) {
+        size_t index = lept_pointer_index(parent, c->stack, c->top);
+        if (index >= parent->u.a.size)
+            return LEPT_PATCH_PATH_NOT_FOUND;
+        value->lept_move(&parent->u.a.e[index]);
+        parent->lept_erase_array_element(index, 1);
+    }
+    else
+        return LEPT_PATCH_PATH_NOT_FOUND;
+    return LEPT_PATCH_OK;
+}
+
+static lept_value* lept_patch_member(lept_value* op, const char* key, lept_type type) {
+    lept_value* v = op->lept_find_object_value(key, strlen(key));
+    return v && (type == LEPT_NULL || v->type == type) ? v : NULL;
+}
+
+static int lept_patch_operation(lept_context* c, lept_value* doc, lept_value* op) {
+    lept_value *name, *path, *from, *value, *target, temp;
+    int ret;
+    if (op->type != LEPT_OBJECT ||
+        !(name = lept_patch_member(op, "op", LEPT_STRING)) ||
+        !(path = lept_patch_member(op, "path", LEPT_STRING)))
+        return LEPT_PATCH_INVALID_OPERATION;
+    value = lept_patch_member(op, "value", LEPT_NULL);
+    from = lept_patch_member(op, "from", LEPT_STRING);
+#define OP_IS(op) (name->u.s.len == sizeof(op) - 1 && memcmp(name->u.s.s, op, sizeof(op) - 1) == 0)
+    if (OP_IS("add") || OP_IS("replace")) {
+        if (!value)
+            return LEPT_PATCH_INVALID_OPERATION;
+        if (OP_IS("replace")) {
+            if ((ret = lept_pointer_resolve(c, doc, path, &target)) != LEPT_PATCH_OK)
+                return ret;
+            target->lept_copy(value);
+            return LEPT_PATCH_OK;
+        }
+        temp.lept_copy(value);
+    }
+    else if (OP_IS("remove")) {
+        ret = lept_patch_remove(c, doc, path, &temp);
+        temp.lept_free();
+        return ret;
+    }
+    else if (OP_IS("move") || OP_IS("copy")) {
+        if (!from)
+            return LEPT_PATCH_INVALID_OPERATION;
+        if (OP_IS("move")) {
+            if (from->lept_is_equal(path))
+                return lept_pointer_resolve(c, doc, from, &target);
+            /* a value cannot be moved into one of its own children */
+            if (from->u.s.len < path->u.s.len && path->u.s.s[from->u.s.len] == '/' &&
+                memcmp(from->u.s.s, path->u.s.s, from->u.s.len) == 0)
+                return LEPT_PATCH_INVALID_POINTER;
+            if ((ret = lept_patch_remove(c, doc, from, &temp)) != LEPT_PATCH_OK)
+                return ret;
+        }
+        else {
+            if ((ret = lept_pointer_resolve(c, doc, from, &target)) != LEPT_PATCH_OK)
+                return ret;
+            temp.lept_copy(target);
+        }
+    }
+    else if (OP_IS("test")) {
+        if (!value)
+            return LEPT_PATCH_INVALID_OPERATION;
+        if ((ret = lept_pointer_resolve(c, doc, path, &target)) != LEPT_PATCH_OK)
+            return ret;
+        return target->lept_is_equal(value) ? LEPT_PATCH_OK : LEPT_PATCH_TEST_FAILED;
+    }
+    else
+        return LEPT_PATCH_INVALID_OPERATION;
+#undef OP_IS
+    ret = lept_patch_add(c, doc, path, &temp);
+    temp.lept_free();
+    return ret;
+}
+
+int lept_apply_patch(lept_value* doc, lept_value* patch) {
+    lept_context c;
+    int ret = LEPT_PATCH_OK;
+    assert(doc != NULL && patch != NULL);
+    if (patch->type != LEPT_ARRAY)
+        return LEPT_PATCH_INVALID_OPERATION;
+    c.size = LEPT_PARSE_STACK_INIT_SIZE;
+    c.stack = (char*)malloc(c.size);
+    c.top = 0;
+    for (size_t i = 0; i < patch->u.a.size && ret == LEPT_PATCH_OK; i++)
+        ret = lept_patch_operation(&c, doc, &patch->u.a.e[i]);
+    free(c.stack);
+    return ret;
+}
+
+/* arrays whose changed middle part exceeds this many LCS cells are diffed by position */
+#ifndef LEPT_DIFF_LCS_MAX_CELLS
+#define LEPT_DIFF_LCS_MAX_CELLS (1 << 20)
+#endif
+
+/* the path of the value being diffed is kept in c->stack */
+static lept_value* lept_diff_op(lept_context* c, lept_value* patch, const char* op) {
+    lept_value* o = patch->lept_pushback_array_element();
+    o->lept_set_object(3);
+    o->lept_set_object_value("op", 2)->lept_set_string(op, strlen(op));
+    o->lept_set_object_value("path", 4)->lept_set_string(c->stack, c->top);
+    return o;
+}
+
+static void lept_diff_path_key(lept_context* c, const char* k, size_t klen) {
+    PUTC(c, '/');
+    for (size_t i = 0; i < klen; i++) {
+        if (k[i] == '~')
+            PUTS(c, "~0", 2);
+        else if (k[i] == '/')
+            PUTS(c, "~1", 2);
+        else
+            PUTC(c, k[i]);
+    }
+}
+
+static void lept_diff_path_index(lept_context* c, size_t index) {
+    char buffer[24];
+    int len = sprintf(buffer, "/%lu", (unsigned long)index);
+    PUTS(c, buffer, (size_t)len);
+}
+
+static void lept_diff_value(lept_context* c, lept_value* patch, lept_value* a, lept_value* b);
+
+/* whether some key of o occurs twice; lookups return the first member with a key */
+static int lept_diff_has_duplicate_keys(lept_value* o, const lept_member_index* idx) {
+    for (size_t i = 0; i < o->u.o.size; i++) {
+        lept_member* m = &o->u.o.m[i];
+        if ((idx ? lept_member_index_find(idx, o, m->k, m->klen) : o->lept_find_object_index(m->k, m->klen)) != i)
+            return 1;
+    }
+    return 0;
+}
+
+static void lept_diff_object(lept_context* c, lept_value* patch, lept_value* a, lept_value* b) {
+    size_t head = c->top;
+    lept_member_index ia, ib;
+    int large = a->u.o.size >= LEPT_OBJECT_INDEX_MIN_SIZE || b->u.o.size >= LEPT_OBJECT_INDEX_MIN_SIZE;
+    if (large) {
+        lept_member_index_init(&ia, a);
+        lept_member_index_init(&ib, b);
+    }
+    if (lept_diff_has_duplicate_keys(a, large ? &ia : NULL) || lept_diff_has_duplicate_keys(b, large ? &ib : NULL)) {
+        /* a pointer cannot tell duplicate keys apart, such objects are replaced as a whole */
+        if (!a->lept_is_equal(b))
+            lept_diff_op(c, patch, "replace")->lept_set_object_value("value", 5)->lept_copy(b);
+        if (large) {
+            lept_member_index_free(&ia);
+            lept_member_index_free(&ib);
+        }
+        return;
+    }
+    for (size_t i = 0; i < a->u.o.size; i++) {
+        lept_member* m = &a->u.o.m[i];
+        size_t index = large ? lept_member_index_find(&ib, b, m->k, m->klen)
+                             : b->lept_find_object_index(m->k, m->klen);
+        lept_diff_path_key(c, m->k, m->klen);
+        if (index == LEPT_KEY_NOT_EXIST)
+            lept_diff_op(c, patch, "remove");
+        else
+            lept_diff_value(c, patch, &m->v, &b->u.o.m[index].v);
+        c->top = head;
+    }
+    for (size_t i = 0; i < b->u.o.size; i++) {
+        lept_member* m = &b->u.o.m[i];
+        size_t index = large ? lept_member_index_find(&ia, a, m->k, m->klen)
+                             : a->lept_find_object_index(m->k, m->klen);
+        if (index == LEPT_KEY_NOT_EXIST) {
+            lept_diff_path_key(c, m->k, m->klen);
+            lept_diff_op(c, patch, "add")->lept_set_object_value("value", 5)->lept_copy(&m->v);
+            c->top = head;
+        }
+    }
+    if (large) {
+        lept_member_index_free(&ia);
+        lept_member_index_free(&ib);
+    }
+}
+
+static void lept_diff_array(lept_context* c, lept_value* patch, lept_value* a, lept_value* b) {
+    size_t head = c->top, n = a->u.a.size, m = b->u.a.size, begin = 0, i, j, k;
+    unsigned long long *ha, *hb;
+    /* element hashes are computed once and reused by every comparison */
+    ha = (unsigned long long*)malloc((n + m + 1) * sizeof(unsigned long long));
+    hb = ha + n;
+    for (i = 0; i < n; i++)
+        ha[i] = lept_hash_value(&a->u.a.e[i]);
+    for (j = 0; j < m; j++)
+        hb[j] = lept_hash_value(&b->u.a.e[j]);
+#define SAME(i, j) (ha[i] == hb[j] && a->u.a.e[i].lept_is_equal(&b->u.a.e[j]))
+    /* strip common prefix and suffix */
+    while (begin < n && begin < m && SAME(begin, begin))
+        begin++;
+    while (n > begin && m > begin && SAME(n - 1, m - 1))
+        n--, m--;
+    if ((n - begin) * (m - begin) <= LEPT_DIFF_LCS_MAX_CELLS) {
+        /* lcs[i][j]: length of the LCS of a[begin + i, n) and b[begin + j, m) */
+        size_t rows = n - begin + 1, cols = m - begin + 1;
+        size_t* lcs = (size_t*)calloc(rows * cols, sizeof(size_t));
+#define LCS(i, j) lcs[(i) * cols + (j)]
+        for (i = rows - 1; i-- > 0;)
+            for (j = cols - 1; j-- > 0;)
+                LCS(i, j) = SAME(begin + i, begin + j) ? LCS(i + 1, j + 1) + 1 :
+                    (LCS(i + 1, j) > LCS(i, j + 1) ? LCS(i + 1, j) : LCS(i, j + 1));
+        /* walk the alignment; k is the index in the partially patched array */
+        for (i = 0, j = 0, k = begin; i < rows - 1 || j < cols - 1; c->top = head) {
+            if (i < rows - 1 && j < cols - 1 && SAME(begin + i, begin + j))
+                i++, j++, k++;
+            else if (i < rows - 1 && j < cols - 1 && LCS(i + 1, j + 1) == LCS(i, j)) {
+                /* substitution: diff the pair in place */
+                lept_diff_path_index(c, k++);
+                lept_diff_value(c, patch, &a->u.a.e[begin + i++], &b->u.a.e[begin + j++]);
+            }
+            else if (j == cols - 1 || (i < rows - 1 && LCS(i + 1, j) >= LCS(i, j + 1))) {
+                lept_diff_path_index(c, k);
+                lept_diff_op(c, patch, "remove");
+                i++;
+            }
+            else {
+                lept_diff_path_index(c, k++);
+                lept_diff_op(c, patch, "add")->lept_set_object_value("value", 5)->lept_copy(&b->u.a.e[begin + j++]);
+            }
+        }
+#undef LCS
+        free(lcs);
+    }
+    else {
+        /* too large for LCS: diff by position, then trim or extend the tail */
+        for (i = begin; i < n && i < m; i++, c->top = head) {
+            lept_diff_path_index(c, i);
+            lept_diff_value(c, patch, &a->u.a.e[i], &b->u.a.e[i]);
+        }
+        for (k = n; k-- > m; c->top = head) {
+            lept_diff_path_index(c, k);
+            lept_diff_op(c, patch, "remove");
+        }
+        for (j = n; j < m; j++, c->top = head) {
+            lept_diff_path_index(c, j);
+            lept_diff_op(c, patch, "add")->lept_set_object_value("value", 5)->lept_copy(&b->u.a.e[j]);
+        }
+    }
+#undef SAME
+    free(ha);
+}
+
+static void lept_diff_value(lept_context* c, lept_value* patch, lept_value* a, lept_value* b) {
+    if (a->type == b->type && a->type == LEPT_OBJECT)
+        lept_diff_object(c, patch, a, b);
+    else if (a->type == b->type && a->type == LEPT_ARRAY)
+        lept_diff_array(c, patch, a, b);
+    else if (!a->lept_is_equal(b))
+        lept_diff_op(c, patch, "replace")->lept_set_object_value("value", 5)->lept_copy(b);
+}
+
+void lept_diff(lept_value* a, lept_value* b, lept_value* patch) {
+    lept_context c;
+    assert(a != NULL && b != NULL && patch != NULL);
+    c.size = LEPT_PARSE_STACK_INIT_SIZE;
+    c.stack = (char*)malloc(c.size);
+    c.top = 0;
+    patch->lept_set_array(0);
+    lept_diff_value(&c, patch, a, b);
+    free(c.stack);
+}
+
+/* RFC 8949 CBOR */
+
+/* largest magnitude below which every integral double is exact */
+#define LEPT_CBOR_MAX_EXACT_INT 9007199254740992.0     /* 2^53 */
+
+static void lept_cbor_head(lept_context* c, unsigned major, unsigned long long n) {
+    unsigned char buf[9];
+    size_t len;
+    major <<= 5;
+    if (n < 24) {
+        buf[0] = (unsigned char)(major | n);
+        len = 1;
+    }
+    else {
+        len = n <= 0xFF ? 1 : n <= 0xFFFF ? 2 : n <= 0xFFFFFFFFULL ? 4 : 8;
+        buf[0] = (unsigned char)(major | (len == 1 ? 24 : len == 2 ? 25 : len == 4 ? 26 : 27));
+        for (size_t i = len; i > 0; i--, n >>= 8)
+            buf[i] = (unsigned char)(n & 0xFF);
+        len++;
+    }
+    memcpy(lept_context_push(c, len), buf, len);
+}
+
+static void lept_cbor_float(lept_context* c, double n) {
+    unsigned char buf[9];
+    unsigned long long bits;
+    size_t len;
+    /* narrowing a double outside the float range is undefined, so the range is checked first */
+    if (n != n || (std::fabs(n) <= FLT_MAX && (double)(float)n == n)) {
+        float f = (float)n;
+        unsigned int b;
+        memcpy(&b, &f, sizeof(b));
+        bits = b;
+        buf[0] = 0xFA;
+        len = 4;
+    }
+    else {
+        memcpy(&bits, &n, sizeof(bits));
+        buf[0] = 0xFB;
+        len = 8;
+    }
+    for (size_t i = len; i > 0; i--, bits >>= 8)
+        buf[i] = (unsigned char)(bits & 0xFF);
+    memcpy(lept_context_push(c, len + 1), buf, len + 1);
+}
+
+static void lept_cbor_encode(lept_context* c, lept_value* v) {
+    switch (v->type) {
+        case LEPT_NULL:  PUTC(c, (char)0xF6); break;
+        case LEPT_FALSE: PUTC(c, (char)0xF4); break;
+        case LEPT_TRUE:  PUTC(c, (char)0xF5); break;
+        case LEPT_NUMBER: {
+            double n = v->u.n;
+            /* exact integers use the compact integer forms, -0.0 keeps its sign as a float */
+            if (n == std::floor(n) && n >= -LEPT_CBOR_MAX_EXACT_INT && n <= LEPT_CBOR_MAX_EXACT_INT && !(n == 0.0 && std::signbit(n))) {
+                if (n >= 0)
+                    lept_cbor_head(c, 0, (unsigned long long)n);
+                else
+                    lept_cbor_head(c, 1, (unsigned long long)(-1.0 - n));
+            }
+            else
+                lept_cbor_float(c, n);
+            break;
+        }
+        case LEPT_STRING:
+            lept_cbor_head(c, 3, v->u.s.len);
+            PUTS(c, v->u.s.s, v->u.s.len);
+            break;
+        case LEPT_ARRAY:
+            lept_cbor_head(c, 4, v->u.a.size);
+            for (size_t i = 0; i < v->u.a.size; i++)
+                lept_cbor_encode(c, &v->u.a.e[i]);
+            break;
+        case LEPT_OBJECT:
+            lept_cbor_head(c, 5, v->u.o.size);
+            for (size_t i = 0; i < v->u.o.size; i++) {
+                lept_cbor_head(c, 3, v->u.o.m[i].klen);
+                PUTS(c, v->u.o.m[i].k, v->u.o.m[i].klen);
+                lept_cbor_encode(c, &v->u.o.m[i].v);
+            }
+            break;
+    }
+}
+
+char* lept_value::lept_stringify_cbor(size_t* length) {
+    lept_context c;
+    c.size = LEPT_PARSE_STACK_INIT_SIZE;
+    c.stack = (char*)malloc(c.size);
+    c.top = 0;
+    lept_cbor_encode(&c, this);
+    if (length)
+        *length = c.top;
+    return c.stack;
+}
+
+typedef struct {
+    const unsigned char* p;
+    const unsigned char* end;
+    int flags;
+} lept_cbor_reader;
+
+/* read the argument of an item head; ai 31 (indefinite length) is not supported */
+static int lept_cbor_argument(lept_cbor_reader* r, unsigned ai, unsigned long long* n) {
+    size_t len;
+    if (ai < 24) {
+        *n = ai;
+        return LEPT_PARSE_OK;
+    }
+    if (ai > 27)
+        return LEPT_PARSE_INVALID_VALUE;
+    len = (size_t)1 << (ai - 24);
+    if ((size_t)(r->end - r->p) < len)
+        return LEPT_PARSE_INVALID_VALUE;
+    for (*n = 0; len > 0; len--)
+        *n = (*n << 8) | *r->p++;
+    return LEPT_PARSE_OK;
+}
+
+static double lept_cbor_half(unsigned h) {
+    int e = (h >> 10) & 0x1F;
+    double m = h & 0x3FF, n;
+    if (e == 0)
+        n = std::ldexp(m, -24);
+    else if (e != 31)
+        n = std::ldexp(m + 1024, e - 25);
+    else
+        n = m == 0 ? HUGE_VAL : NAN;
+    return (h & 0x8000) ? -n : n;
+}
+
+/* text string of n bytes: copied, or borrowed from the input with LEPT_PARSE_ZERO_COPY */
+static int lept_cbor_text(lept_cbor_reader* r, unsigned long long n, const char** s) {
+    if ((unsigned long long)(r->end - r->p) < n)
+        return LEPT_PARSE_INVALID_VALUE;
+    *s = (const char*)r->p;
+    r->p += n;
+    if ((r->flags & LEPT_PARSE_STRICT_UTF8) && !lept_utf8_valid(*s, (size_t)n))
+        return LEPT_PARSE_INVALID_UTF8;
+    return LEPT_PARSE_OK;
+}
+
+static int lept_cbor_decode(lept_cbor_reader* r, lept_value* v) {
+    unsigned long long n;
+    const char* s;
+    unsigned ib, ai;
+    int ret;
+    if (r->p == r->end)
+        return LEPT_PARSE_EXPECT_VALUE;
+    ib = *r->p++;
+    ai = ib & 0x1F;
+    if (ib >> 5 != 7 && (ret = lept_cbor_argument(r, ai, &n)) != LEPT_PARSE_OK)
+        return ret;
+    switch (ib >> 5) {
+        case 0:
+            v->lept_set_number((double)n);
+            return LEPT_PARSE_OK;
+        case 1:
+            v->lept_set_number(-1.0 - (double)n);
+            return LEPT_PARSE_OK;
+        case 3:
+            if ((ret = lept_cbor_text(r, n, &s)) != LEPT_PARSE_OK)
+                return ret;
+            if (r->flags & LEPT_PARSE_ZERO_COPY) {
+                v->type = LEPT_STRING;
+                v->u.s.s = (char*)s;
+                v->u.s.len = (size_t)n;
+                v->borrowed = 1;
+            }
+            else
+                v->lept_set_string(s, (size_t)n);
+            return LEPT_PARSE_OK;
+        case 4:
+            /* every element takes at least one byte, so n is bounded before allocating */
+            if ((unsigned long long)(r->end - r->p) < n)
+                return LEPT_PARSE_INVALID_VALUE;
+            v->lept_set_array((size_t)n);
+            for (size_t i = 0; i < n; i++)
+                if ((ret = lept_cbor_decode(r, v->lept_pushback_array_element())) != LEPT_PARSE_OK) {
+                    v->lept_free();
+                    return ret;
+                }
+            return LEPT_PARSE_OK;
+        case 5:
+            if ((unsigned long long)(r->end - r->p) / 2 < n)
+                return LEPT_PARSE_INVALID_VALUE;
+            v->lept_set_object((size_t)n);
+            for (size_t i = 0; i < n; i++) {
+                unsigned long long klen;
+                if (r->p == r->end || *r->p >> 5 != 3) {
+                    v->lept_free();
+                    return LEPT_PARSE_MISS_KEY;
+                }
+                ai = *r->p++ & 0x1F;
+                if ((ret = lept_cbor_argument(r, ai, &klen)) != LEPT_PARSE_OK ||
+                    (ret = lept_cbor_text(r, klen, &s)) != LEPT_PARSE_OK) {
+                    v->lept_free();
+                    return ret;
+                }
+                if ((ret = lept_cbor_decode(r, lept_append_object_member(v, s, (size_t)klen))) != LEPT_PARSE_OK) {
+                    v->lept_free();
+                    return ret;
+                }
+            }
+            return LEPT_PARSE_OK;
+        case 6:
+            /* tags carry no meaning for lept_value, decode the tagged item */
+            return lept_cbor_decode(r, v);
+        case 7:
+            switch (ai) {
+                case 20: v->type = LEPT_FALSE; return LEPT_PARSE_OK;
+                case 21: v->type = LEPT_TRUE;  return LEPT_PARSE_OK;
+                case 22:
+                case 23: v->type = LEPT_NULL;  return LEPT_PARSE_OK;  /* null, undefined */
+                case 25:
+                case 26:
+                case 27: {
+                    double d;
+                    if ((ret = lept_cbor_argument(r, ai, &n)) != LEPT_PARSE_OK)
+                        return ret;
+                    if (ai == 25)
+                        d = lept_cbor_half((unsigned)n);
+                    else if (ai == 26) {
+                        unsigned int b = (unsigned int)n;
+                        float f;
+                        memcpy(&f, &b, sizeof(f));
+                        d = f;
+                    }
+                    else
+                        memcpy(&d, &n, sizeof(d));
+                    /* no JSON text parses to these, as in lept_parse_number */
+                    if (d != d)
+                        return LEPT_PARSE_INVALID_VALUE;
+                    if (d == HUGE_VAL || d == -HUGE_VAL)
+                        return LEPT_PARSE_NUMBER_TOO_BIG;
+                    v->lept_set_number(d);
+                    return LEPT_PARSE_OK;
+                }
+                default:
+                    return LEPT_PARSE_INVALID_VALUE;
+            }
+        default:
+            /* byte strings have no JSON counterpart */
+            return LEPT_PARSE_INVALID_VALUE;
+    }
+}
+
+int lept_value::lept_parse_cbor(const char* data, size_t len, int flags) {
+    lept_cbor_reader r;
+    int ret;
+    assert(data != NULL || len == 0);
+    r.p = (const unsigned char*)data;
+    r.end = r.p + len;
+    r.flags = flags;
+    this->type = LEPT_NULL;
+    this->borrowed = 0;
+    if ((ret = lept_cbor_decode(&r, this)) == LEPT_PARSE_OK && r.p != r.end) {
+        lept_free();
+        ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+    return ret;
+}
+
+/* binary image: a header, then 16-byte value nodes with self-relative offsets, everything 8-byte aligned */
+
+#define LEPT_IMAGE_MAGIC        "LEPTIMG"
+#define LEPT_IMAGE_VERSION      1
+#define LEPT_IMAGE_BYTE_ORDER   0x01020304u
+#define LEPT_IMAGE_NODE_SIZE    16
+#define LEPT_IMAGE_MEMBER_SIZE  (2 * LEPT_IMAGE_NODE_SIZE)     /* key string node, value node */
+#define LEPT_IMAGE_TYPE_BITS    3
+#define LEPT_IMAGE_ALIGN(n)     (((n) + 7) & ~(size_t)7)
+
+typedef struct {
+    char magic[8];
+    unsigned version;
+    unsigned byte_order;        /* LEPT_IMAGE_BYTE_ORDER as written by the producer */
+    unsigned long long size;    /* total bytes */
+    unsigned long long reserved;
+} lept_image_header;
+
+enum { LEPT_IMAGE_BORROWED, LEPT_IMAGE_MAPPED, LEPT_IMAGE_ALLOCATED };
+
+/* zeroed and aligned space at the end of the image, returns its position */
+static size_t lept_image_reserve(lept_context* c, size_t n) {
+    size_t pos = c->top;
+    n = LEPT_IMAGE_ALIGN(n);
+    memset(lept_context_push(c, n), 0, n);
+    return pos;
+}
+
+static void lept_image_node(lept_context* c, size_t pos, lept_type type, size_t n, long long offset) {
+    unsigned long long head = (unsigned long long)type | ((unsigned long long)n << LEPT_IMAGE_TYPE_BITS);
+    memcpy(c->stack + pos, &head, sizeof(head));
+    memcpy(c->stack + pos + sizeof(head), &offset, sizeof(offset));
+}
+
+static void lept_image_string(lept_context* c, size_t pos, const char* s, size_t len) {
+    /* the terminating NUL comes from the zeroed space */
+    size_t p = lept_image_reserve(c, len + 1);
+    if (len > 0)
+        memcpy(c->stack + p, s, len);
+    lept_image_node(c, pos, LEPT_STRING, len, (long long)(p - pos));
+}
+
+static void lept_image_encode(lept_context* c, size_t pos, const lept_value* v) {
+    size_t p, i;
+    long long bits;
+    switch (v->type) {
+        case LEPT_NUMBER:
+            memcpy(&bits, &v->u.n, sizeof(bits));
+            lept_image_node(c, pos, LEPT_NUMBER, 0, bits);
+            break;
+        case LEPT_STRING:
+            lept_image_string(c, pos, v->u.s.s, v->u.s.len);
+            break;
+        case LEPT_ARRAY:
+            if (v->u.a.size == 0) {
+                lept_image_node(c, pos, LEPT_ARRAY, 0, 0);
+                break;
+            }
+            p = lept_image_reserve(c, v->u.a.size * LEPT_IMAGE_NODE_SIZE);
+            lept_image_node(c, pos, LEPT_ARRAY, v->u.a.size, (long long)(p - pos));
+            for (i = 0; i < v->u.a.size; i++)
+                lept_image_encode(c, p + i * LEPT_IMAGE_NODE_SIZE, &v->u.a.e[i]);
+            break;
+        case LEPT_OBJECT:
+            if (v->u.o.size == 0) {
+                lept_image_node(c, pos, LEPT_OBJECT, 0, 0);
+                break;
+            }
+            p = lept_image_reserve(c, v->u.o.size * LEPT_IMAGE_MEMBER_SIZE);
+            lept_image_node(c, pos, LEPT_OBJECT, v->u.o.size, (long long)(p - pos));
+            for (i = 0; i < v->u.o.size; i++) {
+                size_t m = p + i * LEPT_IMAGE_MEMBER_SIZE;
+                lept_image_string(c, m, v->u.o.m[i].k, v->u.o.m[i].klen);
+                lept_image_encode(c, m + LEPT_IMAGE_NODE_SIZE, &v->u.o.m[i].v);
+            }
+            break;
+        default:
+            lept_image_node(c, pos, v->type, 0, 0);
+            break;
+    }
+}
+
+char* lept_value::lept_stringify_image(size_t* length) {
+    lept_context c;
+    lept_image_header h;
+    c.size = LEPT_PARSE_STACK_INIT_SIZE;
+    c.stack = (char*)malloc(c.size);
+    c.top = 0;
+    lept_image_reserve(&c, sizeof(lept_image_header) + LEPT_IMAGE_NODE_SIZE);
+    lept_image_encode(&c, sizeof(lept_image_header), this);
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LEPT_IMAGE_MAGIC, sizeof(LEPT_IMAGE_MAGIC));
+    h.version = LEPT_IMAGE_VERSION;
+    h.byte_order = LEPT_IMAGE_BYTE_ORDER;
+    h.size = c.top;
+    memcpy(c.stack, &h, sizeof(h));
+    if (length)
+        *length = c.top;
+    return c.stack;
+}
+
+#define IMAGE_AT(node, offset)  ((const char*)(node) + (offset))
+#define IMAGE_CHILD(node, i, stride) \
+    ((const lept_image_value*)IMAGE_AT(node, (node)->offset + (long long)((i) * (stride))))
+
+lept_type lept_image_value::lept_get_type() const {
+    return (lept_type)(head & ((1 << LEPT_IMAGE_TYPE_BITS) - 1));
+}
+
+int lept_image_value::lept_get_boolean() const {
+    assert(lept_get_type() == LEPT_TRUE || lept_get_type() == LEPT_FALSE);
+    return lept_get_type() == LEPT_TRUE;
+}
+
+double lept_image_value::lept_get_number() const {
+    double n;
+    assert(lept_get_type() == LEPT_NUMBER);
+    memcpy(&n, &offset, sizeof(n));
+    return n;
+}
+
+const char* lept_image_value::lept_get_string() const {
+    assert(lept_get_type() == LEPT_STRING);
+    return IMAGE_AT(this, offset);
+}
+
+size_t lept_image_value::lept_get_string_length() const {
+    assert(lept_get_type() == LEPT_STRING);
+    return (size_t)(head >> LEPT_IMAGE_TYPE_BITS);
+}
+
+size_t lept_image_value::lept_get_array_size() const {
+    assert(lept_get_type() == LEPT_ARRAY);
+    return (size_t)(head >> LEPT_IMAGE_TYPE_BITS);
+}
+
+const lept_image_value* lept_image_value::lept_get_array_element(size_t index) const {
+    assert(index < lept_get_array_size());
+    return IMAGE_CHILD(this, index, LEPT_IMAGE_NODE_SIZE);
+}
+
+size_t lept_image_value::lept_get_object_size() const {
+    assert(lept_get_type() == LEPT_OBJECT);
+    return (size_t)(head >> LEPT_IMAGE_TYPE_BITS);
+}
+
+const char* lept_image_value::lept_get_object_key(size_t index) const {
+    assert(index < lept_get_object_size());
+    return IMAGE_CHILD(this, index, LEPT_IMAGE_MEMBER_SIZE)->lept_get_string();
+}
+
+size_t lept_image_value::lept_get_object_key_length(size_t index) const {
+    assert(index < lept_get_object_size());
+    return IMAGE_CHILD(this, index, LEPT_IMAGE_MEMBER_SIZE)->lept_get_string_length();
+}
+
+const lept_image_value* lept_image_value::lept_get_object_value(size_t index) const {
+    assert(index < lept_get_object_size());
+    return IMAGE_CHILD(this, index, LEPT_IMAGE_MEMBER_SIZE) + 1;
+}
+
+size_t lept_image_value::lept_find_object_index(const char* key, size_t klen) const {
+    assert(lept_get_type() == LEPT_OBJECT && (key != NULL || klen == 0));
+    for (size_t i = 0; i < lept_get_object_size(); i++) {
+        const lept_image_value* k = IMAGE_CHILD(this, i, LEPT_IMAGE_MEMBER_SIZE);
+        if (k->lept_get_string_length() == klen && memcmp(k->lept_get_string(), key, klen) == 0)
+            return i;
+    }
+    return LEPT_KEY_NOT_EXIST;
+}
+
+const lept_image_value* lept_image_value::lept_find_object_value(const char* key, size_t klen) const {
+    size_t index = lept_find_object_index(key, klen);
+    return index != LEPT_KEY_NOT_EXIST ? lept_get_object_value(index) : NULL;
+}
+
+void lept_image_value::lept_to_value(lept_value* v) const {
+    size_t i, n;
+    v->lept_free();
+    switch (lept_get_type()) {
+        case LEPT_NUMBER:
+            v->lept_set_number(lept_get_number());
+            break;
+        case LEPT_STRING:
+            v->lept_set_string(lept_get_string(), lept_get_string_length());
+            break;
+        case LEPT_ARRAY:
+            v->lept_set_array(n = lept_get_array_size());
+            for (i = 0; i < n; i++)
+                lept_get_array_element(i)->lept_to_value(v->lept_pushback_array_element());
+            break;
+        case LEPT_OBJECT:
+            v->lept_set_object(n = lept_get_object_size());
+            for (i = 0; i < n; i++)
+                lept_get_object_value(i)->lept_to_value(
+                    lept_append_object_member(v, lept_get_object_key(i), lept_get_object_key_length(i)));
+            break;
+        default:
+            v->type = lept_get_type();
+            break;
+    }
+}
+
+int lept_image::lept_load(const void* data, size_t size) {
+    lept_image_header h;
+    lept_close();
+    if (data == NULL || ((size_t)data & 7) != 0 || size < sizeof(h) + LEPT_IMAGE_NODE_SIZE)
+        return LEPT_IMAGE_INVALID_FORMAT;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, LEPT_IMAGE_MAGIC, sizeof(LEPT_IMAGE_MAGIC)) != 0 || h.version != LEPT_IMAGE_VERSION ||
+        h.byte_order != LEPT_IMAGE_BYTE_ORDER || h.size != size)
+        return LEPT_IMAGE_INVALID_FORMAT;
+    this->data = (const char*)data;
+    this->size = size;
+    this->owner = LEPT_IMAGE_BORROWED;
+    return LEPT_IMAGE_OK;
+}
+
+int lept_image::lept_open(const char* path) {
+    int ret;
+    lept_close();
+#ifdef LEPT_HAVE_MMAP
+    struct stat st;
+    void* p;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return LEPT_IMAGE_IO_ERROR;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return LEPT_IMAGE_IO_ERROR;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return LEPT_IMAGE_INVALID_FORMAT;
+    }
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return LEPT_IMAGE_IO_ERROR;
+    if ((ret = lept_load(p, (size_t)st.st_size)) != LEPT_IMAGE_OK) {
+        munmap(p, (size_t)st.st_size);
+        return ret;
+    }
+    owner = LEPT_IMAGE_MAPPED;
+#else
+    /* no mmap: read the whole file, malloc() is suitably aligned */
+    FILE* fp = fopen(path, "rb");
+    char* p;
+    long n;
+    if (fp == NULL)
+        return LEPT_IMAGE_IO_ERROR;
+    if (fseek(fp, 0, SEEK_END) != 0 || (n = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return LEPT_IMAGE_IO_ERROR;
+    }
+    p = (char*)malloc(n > 0 ? (size_t)n : 1);
+    if (fread(p, 1, (size_t)n, fp) != (size_t)n) {
+        fclose(fp);
+        free(p);
+        return LEPT_IMAGE_IO_ERROR;
+    }
+    fclose(fp);
+    if ((ret = lept_load(p, (size_t)n)) != LEPT_IMAGE_OK) {
+        free(p);
+        return ret;
+    }
+    owner = LEPT_IMAGE_ALLOCATED;
+#endif
+    return LEPT_IMAGE_OK;
+}
+
+void lept_image::lept_close() {
+#ifdef LEPT_HAVE_MMAP
+    if (owner == LEPT_IMAGE_MAPPED)
+        munmap((void*)data, size);
+#endif
+    if (owner == LEPT_IMAGE_ALLOCATED)
+        free((void*)data);
+    data = NULL;
+    size = 0;
+    owner = LEPT_IMAGE_BORROWED;
+}
+
+const lept_image_value* lept_image::lept_get_root() const {
+    assert(data != NULL);
+    return (const lept_image_value*)(data + sizeof(lept_image_header));
+}
+
 }
@@ -24,18 +24,81 @@ enum {
     LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
     LEPT_PARSE_MISS_KEY,
     LEPT_PARSE_MISS_COLON,
-    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    LEPT_PARSE_INVALID_UTF8,
+    LEPT_PARSE_TYPE_MISMATCH,       /* typed binding: the value does not fit its field */
+    LEPT_PARSE_INCOMPLETE           /* stream parser: more input is needed */
 };
 
+enum {
+    LEPT_PATCH_OK = 200,
+    LEPT_PATCH_INVALID_OPERATION,
+    LEPT_PATCH_INVALID_POINTER,
+    LEPT_PATCH_PATH_NOT_FOUND,
+    LEPT_PATCH_TEST_FAILED
+};
+
+enum {
+    LEPT_IMAGE_OK = 300,
+    LEPT_IMAGE_IO_ERROR,
+    LEPT_IMAGE_INVALID_FORMAT
+};
+
+/* flags for lept_value::lept_parse() */
+enum {
+    LEPT_PARSE_DEFAULT      = 0,
+    LEPT_PARSE_STRICT_UTF8  = 1 << 0,   /* reject strings that are not well-formed UTF-8 */
+    LEPT_PARSE_ZERO_COPY    = 1 << 1    /* CBOR only: strings point into the input, which must outlive
+                                           the value, and are not NUL-terminated */
+};
+
+/* statistics of one parse, only collected when the library is built with LEPT_ENABLE_STATS */
+struct lept_parse_stats {
+    size_t bytes_scanned;
+    size_t strings, escapes, numbers, arrays, objects;  /* strings include object keys */
+    size_t max_depth;
+    size_t stack_reallocs, stack_peak;                  /* parse stack growth, peak bytes in use */
+    size_t mallocs, malloc_bytes;                       /* malloc and realloc calls */
+    unsigned long long string_ns, number_ns, total_ns;
+};
+
+/* element counts of the containers of a document, in the order of their opening brackets */
+class lept_size_hints {
+public:
+    lept_size_hints(): counts(NULL), size(0), capacity(0) {}
+    ~lept_size_hints();
+
+    size_t* counts;
+    size_t size, capacity;
+
+private:
+    lept_size_hints(const lept_size_hints&);
+    lept_size_hints& operator=(const lept_size_hints&);
+};
+
+#define LEPT_KEY_NOT_EXIST ((size_t)-1)
+
 struct lept_member;
+struct lept_context;
+struct lept_stream_state;
 
 class lept_value {
 public:
-    lept_value(): type(LEPT_NULL) {}
+    lept_value(): type(LEPT_NULL), borrowed(0) {}
     
     void lept_free();
 
-    int lept_parse(const char* json);
+    /* with hints, containers are allocated at their hinted size and the actual sizes are
+       recorded back, ready for the next document of the same shape */
+    int lept_parse(const char* json, int flags = LEPT_PARSE_DEFAULT, lept_size_hints* hints = NULL,
+                   lept_parse_stats* stats = NULL);
+
+    /* RFC 8949 CBOR, the returned buffer is released with free() */
+    int lept_parse_cbor(const char* data, size_t len, int flags = LEPT_PARSE_DEFAULT);
+    char* lept_stringify_cbor(size_t* length);
+
+    /* relocatable binary image for lept_image, the returned buffer is released with free() */
+    char* lept_stringify_image(size_t* length);
 
     lept_type lept_get_type();
     void lept_set_type(lept_type t) { type = t; }
@@ -52,23 +115,46 @@ public:
     size_t lept_get_string_length();
     void lept_set_string(const char* s, size_t len);
 
+    void lept_copy(lept_value* src);
+    void lept_move(lept_value* src);
+    void lept_swap(lept_value* rhs);
+
+    void lept_set_array(size_t capacity);
     size_t lept_get_array_size();
+    size_t lept_get_array_capacity();
+    void lept_reserve_array(size_t capacity);
     lept_value* lept_get_array_element(size_t index);
+    lept_value* lept_pushback_array_element();
+    lept_value* lept_insert_array_element(size_t index);
+    void lept_erase_array_element(size_t index, size_t count);
 
+    void lept_set_object(size_t capacity);
     size_t lept_get_object_size();
+    size_t lept_get_object_capacity();
+    void lept_reserve_object(size_t capacity);
     const char* lept_get_object_key(size_t index);
     size_t lept_get_object_key_length(size_t index);
     lept_value* lept_get_object_value(size_t index);
+    size_t lept_find_object_index(const char* key, size_t klen);
+    lept_value* lept_find_object_value(const char* key, size_t klen);
+    lept_value* lept_set_object_value(const char* key, size_t klen);
+    void lept_remove_object_value(size_t index);
+
+    /* deep comparison, member order of objects is not significant */
+    int lept_is_equal(lept_value* rhs);
+    /* deterministic hash consistent with lept_is_equal(), stable across runs */
+    size_t lept_hash();
 
 public:
     union {
-        struct { lept_member* m; size_t size; } o ;
-        struct { lept_value* e; size_t size; } a; /* array */
+        struct { lept_member* m; size_t size, capacity; } o; /* object */
+        struct { lept_value* e; size_t size, capacity; } a; /* array */
         struct { char* s; size_t len; } s;  /* string */
         double n;                          /* number */
     } u;
 public:
     lept_type type;
+    unsigned char borrowed;     /* u.s.s is not owned, see LEPT_PARSE_ZERO_COPY */
 };
 
 struct lept_member {
@@ -76,6 +162,129 @@ struct lept_member {
     lept_value v;           /* member value */
 };
 
+/**
+ * read-only value inside a binary image written by lept_stringify_image(); children are found
+ * through offsets relative to each value, so an image is usable wherever it is mapped
+ **/
+class lept_image_value {
+public:
+    lept_type lept_get_type() const;
+    int lept_get_boolean() const;
+    double lept_get_number() const;
+    const char* lept_get_string() const;
+    size_t lept_get_string_length() const;
+    size_t lept_get_array_size() const;
+    const lept_image_value* lept_get_array_element(size_t index) const;
+    size_t lept_get_object_size() const;
+    const char* lept_get_object_key(size_t index) const;
+    size_t lept_get_object_key_length(size_t index) const;
+    const lept_image_value* lept_get_object_value(size_t index) const;
+    size_t lept_find_object_index(const char* key, size_t klen) const;
+    const lept_image_value* lept_find_object_value(const char* key, size_t klen) const;
+
+    /* deep copy into an ordinary value */
+    void lept_to_value(lept_value* v) const;
+
+private:
+    /* only exists inside an image */
+    lept_image_value();
+    lept_image_value(const lept_image_value&);
+    lept_image_value& operator=(const lept_image_value&);
+
+    unsigned long long head;    /* type in the low 3 bits, string length or element count above */
+    long long offset;           /* payload relative to this value, or the bits of a number */
+};
+
+/**
+ * a binary image, memory mapped from a file or viewed in place; images use the native byte order
+ * and are trusted, only their header is checked
+ **/
+class lept_image {
+public:
+    lept_image(): data(NULL), size(0), owner(0) {}
+    ~lept_image() { lept_close(); }
+
+    int lept_open(const char* path);
+    /* data must be 8-byte aligned and outlive the image */
+    int lept_load(const void* data, size_t size);
+    void lept_close();
+
+    const lept_image_value* lept_get_root() const;
+
+private:
+    const char* data;
+    size_t size;
+    int owner;
+
+    lept_image(const lept_image&);
+    lept_image& operator=(const lept_image&);
+};
+
+/* check that json[0, len) is one JSON text without building it; same result as a strict UTF-8 lept_parse */
+int lept_validate(const char* json, size_t len);
+
+/**
+ * pull reader over a NUL-terminated document, one token at a time; every call skips leading
+ * whitespace and returns a LEPT_PARSE_* code, strings stay valid until the next call
+ **/
+class lept_reader {
+public:
+    lept_reader(const char* json, int flags = LEPT_PARSE_DEFAULT);
+    ~lept_reader();
+
+    /* type of the next value, from its first character; numbers are only checked when read */
+    int lept_peek(lept_type* type);
+    int lept_read_null();
+    int lept_read_boolean(int* b);
+    int lept_read_number(double* n);
+    /* also the number's text, for conversions a double cannot hold exactly */
+    int lept_read_number(double* n, const char** s, size_t* len);
+    int lept_read_string(const char** s, size_t* len);
+    /* more is 0 for an empty container, then each _next call says whether an element follows */
+    int lept_read_array(int* more);
+    int lept_read_array_next(int* more);
+    int lept_read_object(int* more);
+    int lept_read_object_key(const char** k, size_t* klen);
+    int lept_read_object_next(int* more);
+    /* skip the next value without building it, strings are checked as UTF-8 under LEPT_PARSE_STRICT_UTF8 */
+    int lept_skip();
+    /* only whitespace may follow the root value */
+    int lept_read_end();
+
+private:
+    lept_context* c;
+    const char* end;
+
+    lept_reader(const lept_reader&);
+    lept_reader& operator=(const lept_reader&);
+};
+
+/**
+ * incremental parser for input that arrives in chunks, without recursion; the result is the
+ * same as lept_parse() on the concatenated input, *v is only valid once that result is LEPT_PARSE_OK
+ **/
+class lept_stream_parser {
+public:
+    lept_stream_parser(lept_value* v, int flags = LEPT_PARSE_DEFAULT);
+    ~lept_stream_parser();
+
+    /* LEPT_PARSE_INCOMPLETE until the outcome is known, then that outcome */
+    int lept_feed(const char* data, size_t len);
+    /* end of input, never returns LEPT_PARSE_INCOMPLETE */
+    int lept_finish();
+
+private:
+    lept_stream_state* s;
+
+    lept_stream_parser(const lept_stream_parser&);
+    lept_stream_parser& operator=(const lept_stream_parser&);
+};
+
+/* build the RFC 6902 JSON patch that turns a into b */
+void lept_diff(lept_value* a, lept_value* b, lept_value* patch);
+/* apply an RFC 6902 JSON patch in place; on failure doc keeps the operations applied so far */
+int lept_apply_patch(lept_value* doc, lept_value* patch);
+
 }
 
 #endif /* LEPTJSON_H__ */
@@ -0,0 +1,105 @@
+#ifndef LEPTJSON_ASYNC_H__
+#define LEPTJSON_ASYNC_H__
+
+/**
+ * awaitable parse over an asynchronous byte source
+ *
+ * a source is any object whose read(char* buf, size_t size) returns an awaitable yielding the
+ * number of bytes stored in buf, 0 at the end of input:
+ *
+ *     int ret = co_await lept_parse_async(socket_body, &v);
+ *
+ * the parse suspends whenever the source does and keeps its state in the coroutine frame
+ **/
+
+#if __cplusplus < 202002L
+#error "leptjson_async.h requires C++20"
+#endif
+
+#include "leptjson.h"
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#ifndef LEPT_ASYNC_CHUNK_SIZE
+#define LEPT_ASYNC_CHUNK_SIZE 4096
+#endif
+
+namespace leptjson {
+
+/* lazily started coroutine returning T, resumes its awaiter when done */
+template <typename T>
+class lept_task {
+public:
+    struct promise_type {
+        T value;
+        std::coroutine_handle<> continuation;
+
+        lept_task get_return_object() {
+            return lept_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                std::coroutine_handle<> c = h.promise().continuation;
+                return c ? c : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        final_awaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    lept_task(lept_task&& rhs) noexcept : h(std::exchange(rhs.h, nullptr)) {}
+    lept_task& operator=(lept_task&& rhs) noexcept {
+        if (this != &rhs) {
+            if (h)
+                h.destroy();
+            h = std::exchange(rhs.h, nullptr);
+        }
+        return *this;
+    }
+    ~lept_task() {
+        if (h)
+            h.destroy();
+    }
+
+    /* awaited from another coroutine */
+    bool await_ready() const noexcept { return h.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        h.promise().continuation = awaiter;
+        return h;
+    }
+    T await_resume() { return std::move(h.promise().value); }
+
+    /* driven by hand, e.g. from an event loop: run until the first suspension */
+    void lept_start() { h.resume(); }
+    bool lept_done() const { return h.done(); }
+    T& lept_result() { return h.promise().value; }
+
+private:
+    explicit lept_task(std::coroutine_handle<promise_type> h): h(h) {}
+
+    std::coroutine_handle<promise_type> h;
+};
+
+/* parse everything src delivers into *v, with the same result as lept_parse() on the whole input */
+template <typename Source>
+lept_task<int> lept_parse_async(Source& src, lept_value* v, int flags = LEPT_PARSE_DEFAULT) {
+    lept_stream_parser parser(v, flags);
+    char buf[LEPT_ASYNC_CHUNK_SIZE];
+    for (;;) {
+        size_t n = co_await src.read(buf, sizeof(buf));
+        int ret = n > 0 ? parser.lept_feed(buf, n) : parser.lept_finish();
+        if (ret != LEPT_PARSE_INCOMPLETE)
+            co_return ret;
+    }
+}
+
+}
+
+#endif /* LEPTJSON_ASYNC_H__ */
@@ -0,0 +1,481 @@
+#ifndef LEPTJSON_BIND_H__
+#define LEPTJSON_BIND_H__
+
+/**
+ * typed binding: parse JSON straight into C++ structs and stringify them back, without a lept_value tree
+ *
+ *     struct point { double x, y; std::string name; };
+ *     LEPT_BIND(point, LEPT_FIELD(point, x), LEPT_FIELD(point, y), lept_field("label", &point::name))
+ *
+ *     point p;
+ *     int ret = lept_bind_parse("{\"x\":1,\"y\":2,\"label\":\"a\"}", &p);
+ *
+ * fields may be bool, arithmetic types, std::string, std::vector, std::optional or other bound structs;
+ * keys are dispatched through a perfect hash computed at compile time, unknown keys are skipped and
+ * missing ones leave their field untouched
+ **/
+
+#include "leptjson.h"
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus < 201703L
+#error "leptjson_bind.h requires C++17"
+#endif
+
+namespace leptjson {
+
+/* specialized by LEPT_BIND with a tuple of lept_field descriptors */
+template <typename T>
+struct lept_binding;
+
+template <typename T, typename M>
+struct lept_field_desc {
+    const char* name;
+    size_t len;
+    M T::* member;
+};
+
+template <typename T, typename M, size_t N>
+constexpr lept_field_desc<T, M> lept_field(const char (&name)[N], M T::* member) {
+    return lept_field_desc<T, M>{ name, N - 1, member };
+}
+
+#define LEPT_FIELD(type, name) ::leptjson::lept_field(#name, &type::name)
+#define LEPT_BIND(type, ...) \
+    template <> struct leptjson::lept_binding<type> { \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__); \
+    };
+
+/**
+ * compile-time perfect hash of the keys of a bound struct, by hash and displace: each key's hash
+ * picks a bucket, and each bucket gets its own displacement that sends its keys to free slots;
+ * buckets hold about one key, so every search is short however many fields there are
+ **/
+
+struct lept_bind_key {
+    const char* name;
+    size_t len;
+};
+
+constexpr unsigned lept_bind_mix(unsigned h) {
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    return h ^ (h >> 12);
+}
+
+constexpr unsigned lept_bind_hash(const char* s, size_t len) {
+    unsigned h = 2166136261u;     /* FNV-1a */
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return lept_bind_mix(h);
+}
+
+/* slot of a key hash under a bucket's displacement */
+constexpr size_t lept_bind_slot(unsigned h, unsigned disp, size_t slots) {
+    return lept_bind_mix(h ^ disp * 0x9e3779b9u) & (slots - 1);
+}
+
+/* a power of two with at least n entries */
+constexpr size_t lept_bind_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+template <size_t N>
+constexpr bool lept_bind_unique(const std::array<lept_bind_key, N>& keys) {
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = i + 1; j < N; j++)
+            if (keys[i].len == keys[j].len) {
+                size_t k = 0;
+                while (k < keys[i].len && keys[i].name[k] == keys[j].name[k])
+                    k++;
+                if (k == keys[i].len)
+                    return false;
+            }
+    return true;
+}
+
+#define LEPT_BIND_MAX_DISP 65536
+
+template <size_t B, size_t S>
+struct lept_bind_table {
+    std::array<unsigned, B> disp;   /* bucket -> displacement */
+    std::array<int, S> index;       /* slot -> field index, -1 for empty slots */
+    bool ok;
+};
+
+template <size_t N, size_t B, size_t S>
+constexpr lept_bind_table<B, S> lept_bind_build(const std::array<lept_bind_key, N>& keys, bool unique) {
+    lept_bind_table<B, S> t{};
+    std::array<unsigned, N> hash{};
+    std::array<size_t, B> size{};
+    std::array<size_t, N> placed{};
+    for (size_t i = 0; i < S; i++)
+        t.index[i] = -1;
+    /* duplicates never fit, they are reported apart */
+    if (!unique)
+        return t;
+    for (size_t i = 0; i < N; i++) {
+        hash[i] = lept_bind_hash(keys[i].name, keys[i].len);
+        size[hash[i] & (B - 1)]++;
+    }
+    /* the largest buckets go first, while most slots are free */
+    for (size_t n = N; n > 0; n--)
+        for (size_t b = 0; b < B; b++) {
+            if (size[b] != n)
+                continue;
+            unsigned d = 0;
+            for (; d < LEPT_BIND_MAX_DISP; d++) {
+                size_t m = 0;
+                for (size_t i = 0; i < N; i++) {
+                    if ((hash[i] & (B - 1)) != b)
+                        continue;
+                    size_t slot = lept_bind_slot(hash[i], d, S), j = 0;
+                    while (j < m && placed[j] != slot)
+                        j++;
+                    if (t.index[slot] >= 0 || j < m)
+                        break;
+                    placed[m++] = slot;
+                }
+                if (m == n)
+                    break;
+            }
+            if (d == LEPT_BIND_MAX_DISP)
+                return t;
+            t.disp[b] = d;
+            for (size_t i = 0; i < N; i++)
+                if ((hash[i] & (B - 1)) == b)
+                    t.index[lept_bind_slot(hash[i], d, S)] = (int)i;
+        }
+    t.ok = true;
+    return t;
+}
+
+template <typename T, size_t... I>
+constexpr std::array<lept_bind_key, sizeof...(I)> lept_bind_keys(std::index_sequence<I...>) {
+    return {{ { std::get<I>(lept_binding<T>::fields).name, std::get<I>(lept_binding<T>::fields).len }... }};
+}
+
+template <typename T>
+struct lept_bind_map {
+    static constexpr size_t count = std::tuple_size<std::decay_t<decltype(lept_binding<T>::fields)>>::value;
+    static constexpr std::array<lept_bind_key, count> keys = lept_bind_keys<T>(std::make_index_sequence<count>());
+    static constexpr size_t buckets = lept_bind_pow2(count);
+    static constexpr size_t slots = lept_bind_pow2(2 * count);
+    static constexpr bool unique = lept_bind_unique(keys);
+    static_assert(unique, "duplicate keys in LEPT_BIND");
+    static constexpr lept_bind_table<buckets, slots> table = lept_bind_build<count, buckets, slots>(keys, unique);
+    static_assert(table.ok || !unique, "LEPT_BIND found no perfect hash for these keys");
+
+    /* field index of key, or -1 */
+    static int find(const char* k, size_t klen) {
+        unsigned h = lept_bind_hash(k, klen);
+        int i = table.index[lept_bind_slot(h, table.disp[h & (buckets - 1)], slots)];
+        if (i < 0 || keys[i].len != klen || memcmp(keys[i].name, k, klen) != 0)
+            return -1;
+        return i;
+    }
+};
+
+/* JSON output */
+
+inline void lept_bind_write_string(std::string* json, const char* s, size_t len) {
+    static const char hex[] = "0123456789ABCDEF";
+    json->push_back('"');
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)s[i];
+        switch (ch) {
+            case '\"': json->append("\\\""); break;
+            case '\\': json->append("\\\\"); break;
+            case '\b': json->append("\\b");  break;
+            case '\f': json->append("\\f");  break;
+            case '\n': json->append("\\n");  break;
+            case '\r': json->append("\\r");  break;
+            case '\t': json->append("\\t");  break;
+            default:
+                if (ch < 0x20) {
+                    char buf[6] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 15] };
+                    json->append(buf, 6);
+                }
+                else
+                    json->push_back((char)ch);
+        }
+    }
+    json->push_back('"');
+}
+
+/* read and write one field type; specialized below */
+template <typename V, typename = void>
+struct lept_bind_traits;
+
+/* LEPT_FALSE stands for both booleans */
+inline int lept_bind_expect(lept_reader* r, lept_type type) {
+    lept_type t;
+    int ret;
+    if ((ret = r->lept_peek(&t)) != LEPT_PARSE_OK)
+        return ret;
+    if (t == LEPT_TRUE && type == LEPT_FALSE)
+        return LEPT_PARSE_OK;
+    return t == type ? LEPT_PARSE_OK : LEPT_PARSE_TYPE_MISMATCH;
+}
+
+template <>
+struct lept_bind_traits<bool> {
+    static int read(lept_reader* r, bool* v) {
+        int b, ret;
+        if ((ret = lept_bind_expect(r, LEPT_FALSE)) != LEPT_PARSE_OK ||
+            (ret = r->lept_read_boolean(&b)) != LEPT_PARSE_OK)
+            return ret;
+        *v = b != 0;
+        return LEPT_PARSE_OK;
+    }
+    static void write(std::string* json, const bool& v) {
+        json->append(v ? "true" : "false");
+    }
+};
+
+/**
+ * integers must be integral and in range: plain integer text is converted exactly, numbers with a
+ * fraction or exponent only below 2^53, where the double holds them exactly; floating point values
+ * must fit the field, and null reads as the nan that non-finite values are written as
+ **/
+template <typename V>
+struct lept_bind_traits<V, std::enable_if_t<std::is_arithmetic<V>::value && !std::is_same<V, bool>::value>> {
+    static int read_integer(const char* s, size_t len, double n, V* v) {
+        const char* p = s + (*s == '-');
+        char buf[32];
+        while (p < s + len && *p >= '0' && *p <= '9')
+            p++;
+        if (p != s + len) {
+            if (n != std::floor(n) || !(std::fabs(n) < 9007199254740992.0) ||
+                n < (double)std::numeric_limits<V>::min() || n > (double)std::numeric_limits<V>::max())
+                return LEPT_PARSE_TYPE_MISMATCH;
+            *v = (V)n;
+            return LEPT_PARSE_OK;
+        }
+        /* the text is not NUL-terminated; anything this long is beyond 64 bits */
+        if (len >= sizeof(buf))
+            return LEPT_PARSE_TYPE_MISMATCH;
+        memcpy(buf, s, len);
+        buf[len] = '\0';
+        errno = 0;
+        if constexpr (std::is_signed<V>::value) {
+            long long i = std::strtoll(buf, NULL, 10);
+            if (errno == ERANGE || i < (long long)std::numeric_limits<V>::min() ||
+                i > (long long)std::numeric_limits<V>::max())
+                return LEPT_PARSE_TYPE_MISMATCH;
+            *v = (V)i;
+        }
+        else {
+            /* strtoull wraps negative values around */
+            if (n < 0)
+                return LEPT_PARSE_TYPE_MISMATCH;
+            unsigned long long u = std::strtoull(buf, NULL, 10);
+            if (errno == ERANGE || u > (unsigned long long)std::numeric_limits<V>::max())
+                return LEPT_PARSE_TYPE_MISMATCH;
+            *v = (V)u;
+        }
+        return LEPT_PARSE_OK;
+    }
+
+    static int read(lept_reader* r, V* v) {
+        lept_type t;
+        const char* s;
+        size_t len;
+        double n;
+        int ret;
+        if ((ret = r->lept_peek(&t)) != LEPT_PARSE_OK)
+            return ret;
+        if constexpr (std::is_floating_point<V>::value) {
+            if (t == LEPT_NULL) {
+                if ((ret = r->lept_read_null()) == LEPT_PARSE_OK)
+                    *v = std::numeric_limits<V>::quiet_NaN();
+                return ret;
+            }
+        }
+        if (t != LEPT_NUMBER)
+            return LEPT_PARSE_TYPE_MISMATCH;
+        if ((ret = r->lept_read_number(&n, &s, &len)) != LEPT_PARSE_OK)
+            return ret;
+        if constexpr (std::is_integral<V>::value)
+            return read_integer(s, len, n, v);
+        else {
+            typedef std::numeric_limits<V> limits;
+            /* a narrower type rounds up to infinity from max + half an ulp, below that to max */
+            if constexpr (limits::max_exponent < std::numeric_limits<double>::max_exponent) {
+                if (std::fabs(n) >= (double)limits::max() + std::ldexp(1.0, limits::max_exponent - limits::digits - 1))
+                    return LEPT_PARSE_NUMBER_TOO_BIG;
+            }
+            *v = (V)n;
+            return LEPT_PARSE_OK;
+        }
+    }
+    static void write(std::string* json, const V& v) {
+        char buf[32];
+        if constexpr (std::is_integral<V>::value)
+            json->append(std::to_string(v));
+        else if (!std::isfinite((double)v))
+            json->append("null");   /* JSON has no inf or nan */
+        else
+            json->append(buf, snprintf(buf, sizeof(buf), "%.17g", (double)v));
+    }
+};
+
+template <>
+struct lept_bind_traits<std::string> {
+    static int read(lept_reader* r, std::string* v) {
+        const char* s;
+        size_t len;
+        int ret;
+        if ((ret = lept_bind_expect(r, LEPT_STRING)) != LEPT_PARSE_OK ||
+            (ret = r->lept_read_string(&s, &len)) != LEPT_PARSE_OK)
+            return ret;
+        v->assign(s, len);
+        return LEPT_PARSE_OK;
+    }
+    static void write(std::string* json, const std::string& v) {
+        lept_bind_write_string(json, v.data(), v.size());
+    }
+};
+
+template <typename E>
+struct lept_bind_traits<std::vector<E>> {
+    static int read(lept_reader* r, std::vector<E>* v) {
+        int more, ret;
+        if ((ret = lept_bind_expect(r, LEPT_ARRAY)) != LEPT_PARSE_OK ||
+            (ret = r->lept_read_array(&more)) != LEPT_PARSE_OK)
+            return ret;
+        v->clear();
+        while (more) {
+            v->emplace_back();
+            if ((ret = lept_bind_traits<E>::read(r, &v->back())) != LEPT_PARSE_OK ||
+                (ret = r->lept_read_array_next(&more)) != LEPT_PARSE_OK)
+                return ret;
+        }
+        return LEPT_PARSE_OK;
+    }
+    static void write(std::string* json, const std::vector<E>& v) {
+        json->push_back('[');
+        for (size_t i = 0; i < v.size(); i++) {
+            if (i > 0)
+                json->push_back(',');
+            lept_bind_traits<E>::write(json, v[i]);
+        }
+        json->push_back(']');
+    }
+};
+
+/* null resets the optional */
+template <typename E>
+struct lept_bind_traits<std::optional<E>> {
+    static int read(lept_reader* r, std::optional<E>* v) {
+        lept_type t;
+        int ret;
+        if ((ret = r->lept_peek(&t)) != LEPT_PARSE_OK)
+            return ret;
+        if (t == LEPT_NULL) {
+            v->reset();
+            return r->lept_read_null();
+        }
+        return lept_bind_traits<E>::read(r, &v->emplace());
+    }
+    static void write(std::string* json, const std::optional<E>& v) {
+        if (v)
+            lept_bind_traits<E>::write(json, *v);
+        else
+            json->append("null");
+    }
+};
+
+template <typename T, size_t I>
+int lept_bind_read_field(lept_reader* r, T* v) {
+    constexpr auto field = std::get<I>(lept_binding<T>::fields);
+    return lept_bind_traits<std::decay_t<decltype(v->*field.member)>>::read(r, &(v->*field.member));
+}
+
+template <typename T, size_t I>
+void lept_bind_write_field(std::string* json, const T& v) {
+    constexpr auto field = std::get<I>(lept_binding<T>::fields);
+    if (I > 0)
+        json->push_back(',');
+    lept_bind_write_string(json, field.name, field.len);
+    json->push_back(':');
+    lept_bind_traits<std::decay_t<decltype(v.*field.member)>>::write(json, v.*field.member);
+}
+
+/* structs with a LEPT_BIND descriptor */
+template <typename T>
+struct lept_bind_traits<T, std::void_t<decltype(lept_binding<T>::fields)>> {
+    typedef lept_bind_map<T> map;
+
+    template <size_t... I>
+    static int read_field(lept_reader* r, T* v, int i, std::index_sequence<I...>) {
+        typedef int (*read_fn)(lept_reader*, T*);
+        static constexpr read_fn readers[] = { &lept_bind_read_field<T, I>..., NULL };
+        return readers[i](r, v);
+    }
+
+    static int read(lept_reader* r, T* v) {
+        const char* k;
+        size_t klen;
+        int more, ret, i;
+        if ((ret = lept_bind_expect(r, LEPT_OBJECT)) != LEPT_PARSE_OK ||
+            (ret = r->lept_read_object(&more)) != LEPT_PARSE_OK)
+            return ret;
+        while (more) {
+            if ((ret = r->lept_read_object_key(&k, &klen)) != LEPT_PARSE_OK)
+                return ret;
+            /* k is only valid until the next read */
+            if ((i = map::find(k, klen)) < 0)
+                ret = r->lept_skip();
+            else
+                ret = read_field(r, v, i, std::make_index_sequence<map::count>());
+            if (ret != LEPT_PARSE_OK || (ret = r->lept_read_object_next(&more)) != LEPT_PARSE_OK)
+                return ret;
+        }
+        return LEPT_PARSE_OK;
+    }
+
+    template <size_t... I>
+    static void write_fields(std::string* json, const T& v, std::index_sequence<I...>) {
+        (lept_bind_write_field<T, I>(json, v), ...);
+    }
+
+    static void write(std::string* json, const T& v) {
+        json->push_back('{');
+        write_fields(json, v, std::make_index_sequence<map::count>());
+        json->push_back('}');
+    }
+};
+
+/* parse json into *v; on failure *v may be partially filled */
+template <typename T>
+int lept_bind_parse(const char* json, T* v, int flags = LEPT_PARSE_DEFAULT) {
+    lept_reader r(json, flags);
+    int ret = lept_bind_traits<T>::read(&r, v);
+    return ret == LEPT_PARSE_OK ? r.lept_read_end() : ret;
+}
+
+/* append the JSON text of v to *json */
+template <typename T>
+void lept_bind_stringify(const T& v, std::string* json) {
+    lept_bind_traits<T>::write(json, v);
+}
+
+}
+
+#endif /* LEPTJSON_BIND_H__ */
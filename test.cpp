@@ -1,7 +1,9 @@
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "leptjson.h"
+#include "leptjson_bind.h"
 
 using namespace leptjson;
 
@@ -223,6 +225,21 @@ static void test_parse_number() {
     TEST_NUMBER(1.234E+10, "1.234E+10");
     TEST_NUMBER(1.234E-10, "1.234E-10");
     TEST_NUMBER(0.0, "1e-10000"); /* must underflow */
+    TEST_NUMBER(1.05, "1.05");
+    TEST_NUMBER(10.0, "10");
+    TEST_NUMBER(100.5, "100.5");
+    TEST_NUMBER(0.001, "0.001");
+    TEST_NUMBER(1E10, "1e+010");
+
+    TEST_NUMBER(1.0000000000000002, "1.0000000000000002"); /* the smallest number > 1 */
+    TEST_NUMBER( 4.9406564584124654e-324, "4.9406564584124654e-324"); /* minimum denormal */
+    TEST_NUMBER(-4.9406564584124654e-324, "-4.9406564584124654e-324");
+    TEST_NUMBER( 2.2250738585072009e-308, "2.2250738585072009e-308");  /* Max subnormal double */
+    TEST_NUMBER(-2.2250738585072009e-308, "-2.2250738585072009e-308");
+    TEST_NUMBER( 2.2250738585072014e-308, "2.2250738585072014e-308");  /* Min normal positive double */
+    TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
+    TEST_NUMBER( 1.7976931348623157e+308, "1.7976931348623157e+308");  /* Max double */
+    TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
 }
 
 #define TEST_STRING(expect, json)\
@@ -241,6 +258,56 @@ static void test_parse_string() {
     TEST_STRING("Hello\nWorld", "\"Hello\\nWorld\"");
     TEST_STRING("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
 #endif
+    TEST_STRING("Hello\0World", "\"Hello\\u0000World\"");
+    TEST_STRING("\x24", "\"\\u0024\"");         /* Dollar sign U+0024 */
+    TEST_STRING("\xC2\xA2", "\"\\u00A2\"");     /* Cents sign U+00A2 */
+    TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
+    TEST_STRING("\xE2\x82\xAC", "\"\\u20ac\"");
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xE4\xB8\xAD\xE6\x96\x87", "\"\xE4\xB8\xAD\xE6\x96\x87\"");
+}
+
+#define TEST_STRICT_STRING(expect, json)\
+    do {\
+        lept_value v;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json, LEPT_PARSE_STRICT_UTF8));\
+        EXPECT_EQ_INT(LEPT_STRING, v.lept_get_type());\
+        EXPECT_EQ_STRING(expect, v.lept_get_string(), v.lept_get_string_length());\
+        v.lept_free();\
+    } while(0)
+
+#define TEST_STRICT_ERROR(error, json)\
+    do {\
+        lept_value v;\
+        EXPECT_EQ_INT(error, v.lept_parse(json, LEPT_PARSE_STRICT_UTF8));\
+        EXPECT_EQ_INT(LEPT_NULL, v.lept_get_type());\
+    } while(0)
+
+static void test_parse_strict_utf8() {
+    TEST_STRICT_STRING("Hello", "\"Hello\"");
+    TEST_STRICT_STRING("\xC2\xA2", "\"\xC2\xA2\"");
+    TEST_STRICT_STRING("\xE2\x82\xAC", "\"\xE2\x82\xAC\"");
+    TEST_STRICT_STRING("\xED\x9F\xBF", "\"\xED\x9F\xBF\"");                 /* U+D7FF */
+    TEST_STRICT_STRING("\xF0\x9D\x84\x9E", "\"\xF0\x9D\x84\x9E\"");
+    TEST_STRICT_STRING("\xF4\x8F\xBF\xBF", "\"\xF4\x8F\xBF\xBF\"");         /* U+10FFFF */
+    TEST_STRICT_STRING("a\xC2\xA2\n\xE2\x82\xAC", "\"a\xC2\xA2\\n\xE2\x82\xAC\"");
+
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\x80\"");               /* lone continuation */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xBF\"");
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xC0\xAF\"");           /* overlong '/' */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xC1\xBF\"");
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"");       /* overlong */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");       /* surrogate U+D800 */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xF0\x80\x80\xAF\"");   /* overlong */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");   /* > U+10FFFF */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xF5\x80\x80\x80\"");
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xFF\"");
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xC2\"");               /* truncated */
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xE2\x82\"");
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "\"\xF0\x9D\x84\"");
+    TEST_STRICT_ERROR(LEPT_PARSE_INVALID_UTF8, "[\"a\", \"\xC2\x41\"]");
+    TEST_STRICT_ERROR(LEPT_PARSE_MISS_KEY, "{\"\xC2\":1}");
 }
 
 #define TEST_ERROR(error, json)\
@@ -262,6 +329,26 @@ static void test_parse_invalid_number() {
     TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "inf");
     TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "NAN");
     TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "nan");
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "-inf");
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "-");
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "-.5");
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "1e");
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "1e+");
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "1.e5");
+
+    /* invalid value after a valid number */
+    TEST_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "0123");
+    TEST_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "0x0");
+    TEST_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "0x123");
+    TEST_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "1.5.5");
+    TEST_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "0123e999");
+    TEST_ERROR(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[-0157e308]");
+}
+
+static void test_parse_number_too_big() {
+    TEST_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1e309");
+    TEST_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "-1e309");
+    TEST_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "[1, 1e400]");
 }
 
 static void test_parse_invalid_string_escape() {
@@ -301,6 +388,8 @@ static void test_parse_invalid_unicode_surrogate() {
     TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\\\\"");
     TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDBFF\"");
     TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");
+    TEST_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDFFF\\u0041\"");
 }
 
 #if defined(_MSC_VER)
@@ -349,6 +438,185 @@ static void test_parse_array3() {
     v.lept_free();
 }
 
+static void test_parse_hinted() {
+    static const char* json[] = {
+        "[]", "{}", "[ [ ] , [ 0 ] , [ 0 , 1 ] , [ 0 , 1 , 2 ] ]",
+        "[\"a,b]\", \"\\\"]\", {\"[\":\"{,}\"}, [[], {}]]",
+        "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}",
+        /* invalid documents must fail the same way */
+        "[1,2", "[1,,2]", "[1 2]", "{\"a\":1", "{\"a\" 1}", "{1:1}", "{\"a\":[1,}", "[\"abc]", "[1] x", "[,]", "[1,]"
+    };
+    for (size_t i = 0; i < sizeof(json) / sizeof(json[0]); i++) {
+        lept_value v, w, x;
+        lept_size_hints hints;
+        int ret = v.lept_parse(json[i]);
+        /* fresh hints first, then the hints that parse recorded */
+        EXPECT_EQ_INT(ret, w.lept_parse(json[i], LEPT_PARSE_DEFAULT, &hints));
+        EXPECT_EQ_INT(ret, x.lept_parse(json[i], LEPT_PARSE_DEFAULT, &hints));
+        if (ret == LEPT_PARSE_OK) {
+            EXPECT_TRUE(v.lept_is_equal(&w));
+            EXPECT_TRUE(v.lept_is_equal(&x));
+        }
+        else {
+            EXPECT_EQ_INT(LEPT_NULL, w.lept_get_type());
+            EXPECT_EQ_INT(LEPT_NULL, x.lept_get_type());
+        }
+        v.lept_free();
+        w.lept_free();
+        x.lept_free();
+    }
+}
+
+static void test_parse_size_hints() {
+    lept_value v;
+    lept_size_hints hints;
+    /* a parse records the size of every container, in the order of their opening brackets */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse("{\"a\":[1,2,3,4,5],\"b\":{\"c\":[\"x,y\",[]]}}", LEPT_PARSE_DEFAULT, &hints));
+    EXPECT_EQ_SIZE_T(5, hints.size);
+    EXPECT_EQ_SIZE_T(2, hints.counts[0]);
+    EXPECT_EQ_SIZE_T(5, hints.counts[1]);
+    EXPECT_EQ_SIZE_T(1, hints.counts[2]);
+    EXPECT_EQ_SIZE_T(2, hints.counts[3]);
+    EXPECT_EQ_SIZE_T(0, hints.counts[4]);
+    v.lept_free();
+
+    /* hints recorded from one document size the next one of the same shape */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse("{\"a\":[6,7,8,9,10],\"b\":{\"c\":[\"z\",[]]}}", LEPT_PARSE_DEFAULT, &hints));
+    EXPECT_EQ_SIZE_T(2, v.lept_get_object_capacity());
+    EXPECT_EQ_SIZE_T(5, v.lept_find_object_value("a", 1)->lept_get_array_capacity());
+    EXPECT_EQ_SIZE_T(5, v.lept_find_object_value("a", 1)->lept_get_array_size());
+    v.lept_free();
+
+    /* a different shape still parses and updates the hints */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse("[[1,2,3,4,5,6,7,8,9,10,11,12]]", LEPT_PARSE_DEFAULT, &hints));
+    EXPECT_EQ_SIZE_T(12, v.lept_get_array_element(0)->lept_get_array_size());
+    EXPECT_EQ_SIZE_T(2, hints.size);
+    EXPECT_EQ_SIZE_T(1, hints.counts[0]);
+    EXPECT_EQ_SIZE_T(12, hints.counts[1]);
+    v.lept_free();
+
+    /* stale or hostile hints are capped by the length of the input */
+    hints.counts[0] = hints.counts[1] = (size_t)1 << 40;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse("[{\"a\":1}]", LEPT_PARSE_DEFAULT, &hints));
+    EXPECT_TRUE(v.lept_get_array_capacity() <= 5);
+    EXPECT_TRUE(v.lept_get_array_element(0)->lept_get_object_capacity() <= 2);
+    EXPECT_EQ_SIZE_T(1, hints.counts[0]);
+    EXPECT_EQ_SIZE_T(1, hints.counts[1]);
+    v.lept_free();
+}
+
+static void test_parse_stats() {
+    lept_value v;
+    lept_parse_stats stats;
+    const char* json = " { \"a\" : [ 1, 2.5, \"x\\ny\" ], \"b\" : { \"c\" : [ [ ] ] }, \"d\" : \"\\u20AC\" } ";
+    memset(&stats, 0xFF, sizeof(stats));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json, LEPT_PARSE_DEFAULT, NULL, &stats));
+#ifdef LEPT_ENABLE_STATS
+    EXPECT_EQ_SIZE_T(strlen(json), stats.bytes_scanned);
+    EXPECT_EQ_SIZE_T(6, stats.strings);
+    EXPECT_EQ_SIZE_T(2, stats.escapes);
+    EXPECT_EQ_SIZE_T(2, stats.numbers);
+    EXPECT_EQ_SIZE_T(3, stats.arrays);
+    EXPECT_EQ_SIZE_T(2, stats.objects);
+    EXPECT_EQ_SIZE_T(4, stats.max_depth);
+    EXPECT_EQ_SIZE_T(1, stats.stack_reallocs);
+    EXPECT_TRUE(stats.stack_peak >= 3 * sizeof(lept_member));
+    EXPECT_TRUE(stats.mallocs >= 10);
+    EXPECT_TRUE(stats.malloc_bytes >= stats.stack_peak);
+    EXPECT_TRUE(stats.total_ns >= stats.string_ns + stats.number_ns);
+#else
+    /* statistics are compiled out, but the struct is still cleared */
+    EXPECT_EQ_SIZE_T(0, stats.bytes_scanned);
+    EXPECT_EQ_SIZE_T(0, stats.strings);
+    EXPECT_EQ_SIZE_T(0, stats.mallocs);
+    EXPECT_TRUE(stats.total_ns == 0);
+#endif
+    v.lept_free();
+
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, v.lept_parse("[[1, 2] 3]", LEPT_PARSE_DEFAULT, NULL, &stats));
+#ifdef LEPT_ENABLE_STATS
+    EXPECT_EQ_SIZE_T(8, stats.bytes_scanned);
+    EXPECT_EQ_SIZE_T(2, stats.arrays);
+    EXPECT_EQ_SIZE_T(2, stats.max_depth);
+    EXPECT_EQ_SIZE_T(2, stats.numbers);
+#else
+    EXPECT_EQ_SIZE_T(0, stats.arrays);
+#endif
+}
+
+#define TEST_VALIDATE(error, json)\
+    do {\
+        lept_value v;\
+        EXPECT_EQ_INT(error, lept_validate(json, strlen(json)));\
+        EXPECT_EQ_INT(error, v.lept_parse(json, LEPT_PARSE_STRICT_UTF8));\
+        v.lept_free();\
+    } while(0)
+
+static void test_validate() {
+    TEST_VALIDATE(LEPT_PARSE_OK, "null");
+    TEST_VALIDATE(LEPT_PARSE_OK, " [ true , false , -0.5e-3 , \"\" ] ");
+    TEST_VALIDATE(LEPT_PARSE_OK, "{\"n\":{\"a\":[1,[2,{}]]},\"s\":\"0123456789abcdef\\t\\u00e9\\uD834\\uDD1E\xE2\x82\xAC 0123456789\"}");
+    TEST_VALIDATE(LEPT_PARSE_OK, "1.7976931348623157e308");
+    TEST_VALIDATE(LEPT_PARSE_OK, "-179769313486231570000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000.0");
+    TEST_VALIDATE(LEPT_PARSE_OK, "0.000000000000000000001e329");
+    TEST_VALIDATE(LEPT_PARSE_OK, "1e-400");
+
+    TEST_VALIDATE(LEPT_PARSE_EXPECT_VALUE, "");
+    TEST_VALIDATE(LEPT_PARSE_EXPECT_VALUE, " ");
+    TEST_VALIDATE(LEPT_PARSE_EXPECT_VALUE, "[");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_VALUE, "nul");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_VALUE, "[1,]");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_VALUE, "+1");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_VALUE, "1.");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_VALUE, "1e+");
+    TEST_VALIDATE(LEPT_PARSE_ROOT_NOT_SINGULAR, "null x");
+    TEST_VALIDATE(LEPT_PARSE_ROOT_NOT_SINGULAR, "0123");
+    TEST_VALIDATE(LEPT_PARSE_ROOT_NOT_SINGULAR, "0123e999");
+    TEST_VALIDATE(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[-0157e308]");
+    TEST_VALIDATE(LEPT_PARSE_NUMBER_TOO_BIG, "1e309");
+    TEST_VALIDATE(LEPT_PARSE_NUMBER_TOO_BIG, "1.7976931348623159e308");
+    TEST_VALIDATE(LEPT_PARSE_NUMBER_TOO_BIG, "[-0.1e310]");
+    TEST_VALIDATE(LEPT_PARSE_MISS_QUOTATION_MARK, "\"abcdefghijklmnop");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"abcdefgh\\v\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_STRING_CHAR, "\"abcdefghijk\x01\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u12\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u12");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDBFF\\uE000\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UTF8, "\"abcdefgh\xC0\x80\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");
+    TEST_VALIDATE(LEPT_PARSE_INVALID_UTF8, "\"\xE2\x82");
+    TEST_VALIDATE(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1 2]");
+    TEST_VALIDATE(LEPT_PARSE_MISS_KEY, "{1:1}");
+    TEST_VALIDATE(LEPT_PARSE_MISS_KEY, "{\"a\\x\":1}");
+    TEST_VALIDATE(LEPT_PARSE_MISS_COLON, "{\"a\",1}");
+    TEST_VALIDATE(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1]");
+
+    /* long mantissas shift the decimal exponent by far more than the exponent field alone */
+    std::string zeros(1000000, '0');
+    TEST_VALIDATE(LEPT_PARSE_NUMBER_TOO_BIG, ("0." + zeros + "1e1000400").c_str());
+    TEST_VALIDATE(LEPT_PARSE_OK, ("0." + zeros + "1e1000300").c_str());
+    TEST_VALIDATE(LEPT_PARSE_OK, ("1" + zeros + "e-1000100").c_str());
+    TEST_VALIDATE(LEPT_PARSE_NUMBER_TOO_BIG, ("1" + zeros + "e-999000").c_str());
+    TEST_VALIDATE(LEPT_PARSE_OK, "1e-99999999999999999999999999");
+    TEST_VALIDATE(LEPT_PARSE_NUMBER_TOO_BIG, "0.0000000001e99999999999999999999999999");
+
+    /* the length bounds the input, it need not be NUL-terminated */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("[1,2]xyz", 5));
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate("1e3090", 5));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("1e3090", 4));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_validate("\"abc\"", 4));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UNICODE_HEX, lept_validate("\"\\u0041\"", 6));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UTF8, lept_validate("\"\xE2\x82\xAC\"", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_validate("true", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_validate(NULL, 0));
+    /* a NUL byte is not the end */
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_validate("1\0", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_validate("\"a\0\"", 4));
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_true();
@@ -358,7 +626,9 @@ static void test_parse() {
     test_parse_root_not_singular();
     test_parse_number();
     test_parse_invalid_number();
+    test_parse_number_too_big();
     test_parse_string();
+    test_parse_strict_utf8();
     test_parse_invalid_string_escape();
     test_parse_invalid_string_char();
     test_parse_invalid_unicode_hex();
@@ -373,10 +643,865 @@ static void test_parse() {
     test_parse_miss_key();
     test_parse_miss_comma_or_curly_bracket();
 #endif
+    test_parse_hinted();
+    test_parse_size_hints();
+    test_parse_stats();
+    test_validate();
+}
+
+#define TEST_EQUAL(json1, json2, equality) \
+    do {\
+        lept_value v1, v2;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse(json1));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse(json2));\
+        EXPECT_EQ_INT(equality, v1.lept_is_equal(&v2));\
+        EXPECT_EQ_INT(equality, v2.lept_is_equal(&v1));\
+        if (equality)\
+            EXPECT_TRUE(v1.lept_hash() == v2.lept_hash());\
+        v1.lept_free();\
+        v2.lept_free();\
+    } while(0)
+
+static void test_equal() {
+    TEST_EQUAL("true", "true", 1);
+    TEST_EQUAL("true", "false", 0);
+    TEST_EQUAL("false", "false", 1);
+    TEST_EQUAL("null", "null", 1);
+    TEST_EQUAL("null", "0", 0);
+    TEST_EQUAL("123", "123", 1);
+    TEST_EQUAL("123", "456", 0);
+    TEST_EQUAL("0", "-0", 1);
+    TEST_EQUAL("\"abc\"", "\"abc\"", 1);
+    TEST_EQUAL("\"abc\"", "\"abd\"", 0);
+    TEST_EQUAL("\"a\\u0000b\"", "\"a\\u0000c\"", 0);
+    TEST_EQUAL("[]", "[]", 1);
+    TEST_EQUAL("[]", "null", 0);
+    TEST_EQUAL("[1,2,3]", "[1,2,3]", 1);
+    TEST_EQUAL("[1,2,3]", "[1,2,3,4]", 0);
+    TEST_EQUAL("[1,2,3]", "[3,2,1]", 0);
+    TEST_EQUAL("[[]]", "[[]]", 1);
+    TEST_EQUAL("{}", "{}", 1);
+    TEST_EQUAL("{}", "null", 0);
+    TEST_EQUAL("{}", "[]", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"c\":2}", 0);
+    TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
+    TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+
+    /* duplicate keys compare as a multiset of members */
+    TEST_EQUAL("{\"a\":1,\"a\":1}", "{\"a\":1,\"a\":1}", 1);
+    TEST_EQUAL("{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":1}", 1);
+    TEST_EQUAL("{\"a\":1,\"a\":1}", "{\"a\":1,\"a\":2}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":1}", "{\"a\":1,\"a\":1}", 0);
+    TEST_EQUAL("{\"a\":{\"x\":1,\"x\":2},\"a\":[]}", "{\"a\":[],\"a\":{\"x\":2,\"x\":1}}", 1);
+}
+
+static void test_equal_large_object() {
+    char json1[1024], json2[1024];
+    size_t n1 = 0, n2 = 0;
+    lept_value v1, v2;
+    /* same 40 members, inserted in opposite order, so the hashed lookup is used */
+    n1 += sprintf(json1 + n1, "{");
+    n2 += sprintf(json2 + n2, "{");
+    for (int i = 0; i < 40; i++) {
+        n1 += sprintf(json1 + n1, "%s\"k%d\":%d", i ? "," : "", i, i);
+        n2 += sprintf(json2 + n2, "%s\"k%d\":%d", i ? "," : "", 39 - i, 39 - i);
+    }
+    sprintf(json1 + n1, "}");
+    sprintf(json2 + n2, "}");
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse(json1));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse(json2));
+    EXPECT_EQ_INT(1, v1.lept_is_equal(&v2));
+    EXPECT_EQ_INT(1, v2.lept_is_equal(&v1));
+    EXPECT_TRUE(v1.lept_hash() == v2.lept_hash());
+
+    v2.lept_find_object_value("k7", 2)->lept_set_number(8.0);
+    EXPECT_EQ_INT(0, v1.lept_is_equal(&v2));
+    EXPECT_TRUE(v1.lept_hash() != v2.lept_hash());
+    EXPECT_TRUE(v2.lept_find_object_value("k40", 3) == NULL);
+
+    v1.lept_free();
+    v2.lept_free();
+
+    /* duplicate keys through the hashed lookup: "k0" twice with values 0 and 1 in both, in opposite order */
+    n1 = n2 = 0;
+    n1 += sprintf(json1 + n1, "{");
+    n2 += sprintf(json2 + n2, "{");
+    for (int i = 0; i < 40; i++) {
+        n1 += sprintf(json1 + n1, "%s\"k%d\":%d", i ? "," : "", i < 2 ? 0 : i, i);
+        n2 += sprintf(json2 + n2, "%s\"k%d\":%d", i ? "," : "", 39 - i < 2 ? 0 : 39 - i, 39 - i);
+    }
+    sprintf(json1 + n1, "}");
+    sprintf(json2 + n2, "}");
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse(json1));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse(json2));
+    EXPECT_EQ_INT(1, v1.lept_is_equal(&v2));
+    EXPECT_EQ_INT(1, v2.lept_is_equal(&v1));
+    EXPECT_TRUE(v1.lept_hash() == v2.lept_hash());
+
+    v2.lept_get_object_value(v2.lept_get_object_size() - 2)->lept_set_number(0.0);
+    EXPECT_EQ_INT(0, v1.lept_is_equal(&v2));
+    EXPECT_EQ_INT(0, v2.lept_is_equal(&v1));
+    EXPECT_TRUE(v1.lept_hash() != v2.lept_hash());
+    v1.lept_free();
+    v2.lept_free();
+}
+
+static void test_hash() {
+    lept_value v1, v2;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse("[1,2]"));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse("[2,1]"));
+    EXPECT_TRUE(v1.lept_hash() != v2.lept_hash());
+    v1.lept_free();
+    v2.lept_free();
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse("{\"a\":\"b\"}"));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse("{\"b\":\"a\"}"));
+    EXPECT_TRUE(v1.lept_hash() != v2.lept_hash());
+    v1.lept_free();
+    v2.lept_free();
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse("[[]]"));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse("[{}]"));
+    EXPECT_TRUE(v1.lept_hash() != v2.lept_hash());
+    v1.lept_free();
+    v2.lept_free();
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v1.lept_parse("{\"a\":1,\"a\":1}"));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v2.lept_parse("{\"a\":1,\"a\":2}"));
+    EXPECT_TRUE(v1.lept_hash() != v2.lept_hash());
+    v1.lept_free();
+    v2.lept_free();
+}
+
+#define TEST_PATCH(expect, json, patch_json, result)\
+    do {\
+        lept_value v, p, e;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, p.lept_parse(patch_json));\
+        EXPECT_EQ_INT(result, lept_apply_patch(&v, &p));\
+        if (result == LEPT_PATCH_OK) {\
+            EXPECT_EQ_INT(LEPT_PARSE_OK, e.lept_parse(expect));\
+            EXPECT_TRUE(v.lept_is_equal(&e));\
+        }\
+        v.lept_free();\
+        p.lept_free();\
+        e.lept_free();\
+    } while(0)
+
+static void test_apply_patch() {
+    /* examples from RFC 6902 appendix A */
+    TEST_PATCH("{\"baz\":\"qux\",\"foo\":\"bar\"}", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "{\"foo\":[\"bar\",\"baz\"]}",
+        "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}",
+        "[{\"op\":\"remove\",\"path\":\"/baz\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"foo\":[\"bar\",\"baz\"]}", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}",
+        "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"baz\":\"boo\",\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}",
+        "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}",
+        "{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+        "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}", "{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+        "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}", "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+        "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]", LEPT_PATCH_OK);
+    TEST_PATCH("", "{\"baz\":\"qux\"}",
+        "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]", LEPT_PATCH_TEST_FAILED);
+    TEST_PATCH("{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]", LEPT_PATCH_OK);
+    TEST_PATCH("", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]", LEPT_PATCH_PATH_NOT_FOUND);
+    TEST_PATCH("{\"/\":9,\"~1\":10}", "{\"/\":9,\"~1\":10}",
+        "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"foo\":[\"bar\",[\"abc\",\"def\"]]}", "{\"foo\":[\"bar\"]}",
+        "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]", LEPT_PATCH_OK);
+
+    /* whole document, copy and errors */
+    TEST_PATCH("[1,2]", "{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1,2]}]", LEPT_PATCH_OK);
+    TEST_PATCH("{\"a\":{\"b\":1},\"c\":{\"b\":1}}", "{\"a\":{\"b\":1}}",
+        "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/c\"}]", LEPT_PATCH_OK);
+    TEST_PATCH("", "{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b\"}]", LEPT_PATCH_INVALID_POINTER);
+    TEST_PATCH("", "[1,2]", "[{\"op\":\"add\",\"path\":\"/3\",\"value\":3}]", LEPT_PATCH_PATH_NOT_FOUND);
+    TEST_PATCH("", "[1,2]", "[{\"op\":\"add\",\"path\":\"/01\",\"value\":3}]", LEPT_PATCH_PATH_NOT_FOUND);
+    TEST_PATCH("", "[1,2]", "[{\"op\":\"remove\",\"path\":\"/2\"}]", LEPT_PATCH_PATH_NOT_FOUND);
+    TEST_PATCH("", "{}", "[{\"op\":\"add\",\"path\":\"a\",\"value\":1}]", LEPT_PATCH_INVALID_POINTER);
+    TEST_PATCH("", "{}", "[{\"op\":\"add\",\"path\":\"/~2\",\"value\":1}]", LEPT_PATCH_INVALID_POINTER);
+    TEST_PATCH("", "{}", "[{\"op\":\"add\",\"path\":\"/a\"}]", LEPT_PATCH_INVALID_OPERATION);
+    TEST_PATCH("", "{}", "[{\"op\":\"frobnicate\",\"path\":\"/a\"}]", LEPT_PATCH_INVALID_OPERATION);
+    TEST_PATCH("", "{}", "{\"op\":\"add\",\"path\":\"/a\",\"value\":1}", LEPT_PATCH_INVALID_OPERATION);
+}
+
+#define TEST_DIFF(json1, json2, ops)\
+    do {\
+        lept_value a, b, p;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, a.lept_parse(json1));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, b.lept_parse(json2));\
+        lept_diff(&a, &b, &p);\
+        EXPECT_EQ_SIZE_T(ops, p.lept_get_array_size());\
+        EXPECT_EQ_INT(LEPT_PATCH_OK, lept_apply_patch(&a, &p));\
+        EXPECT_TRUE(a.lept_is_equal(&b));\
+        EXPECT_TRUE(b.lept_is_equal(&a));\
+        a.lept_free();\
+        b.lept_free();\
+        p.lept_free();\
+    } while(0)
+
+static void test_diff() {
+    TEST_DIFF("null", "null", 0);
+    TEST_DIFF("null", "1", 1);
+    TEST_DIFF("{\"a\":1}", "[1]", 1);
+    TEST_DIFF("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 0);
+    TEST_DIFF("{\"a\":1,\"b\":2}", "{\"a\":1,\"c\":2}", 2);
+    TEST_DIFF("{\"a\":{\"b\":{\"c\":1,\"d\":2}}}", "{\"a\":{\"b\":{\"c\":1,\"d\":3}}}", 1);
+    TEST_DIFF("{\"a/b\":1,\"m~n\":2}", "{\"a/b\":2,\"m~n\":3}", 2);
+    TEST_DIFF("[1,2,3]", "[1,2,4,3]", 1);
+    TEST_DIFF("[1,2,3]", "[2,3]", 1);
+    TEST_DIFF("[1,2,3]", "[3,2,1]", 2);
+    TEST_DIFF("[1,2,3,4,5]", "[0,1,3,5,6]", 4);
+    TEST_DIFF("[{\"a\":1},{\"b\":2}]", "[{\"a\":1},{\"b\":3}]", 1);
+    TEST_DIFF("[]", "[[1],[2]]", 2);
+    TEST_DIFF("[[1],[2]]", "[]", 2);
+    TEST_DIFF("\"abc\"", "\"abd\"", 1);
+
+    /* objects with duplicate keys are replaced whole unless they are equal */
+    TEST_DIFF("{\"a\":1,\"a\":1}", "{\"a\":1,\"a\":2}", 1);
+    TEST_DIFF("{\"a\":1,\"a\":2}", "{\"a\":1,\"a\":1}", 1);
+    TEST_DIFF("{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":1}", 0);
+    TEST_DIFF("{\"a\":1}", "{\"a\":1,\"a\":1}", 1);
+    TEST_DIFF("[{\"x\":{\"a\":[],\"a\":[1]}}]", "[{\"x\":{\"a\":[1],\"a\":[1]}}]", 1);
+}
+
+static void test_diff_large_array() {
+    lept_value a, b, p;
+    /* a reversed array is too large for the LCS table and is diffed by position */
+    a.lept_set_array(0);
+    b.lept_set_array(0);
+    for (int i = 0; i < 2000; i++) {
+        a.lept_pushback_array_element()->lept_set_number(i);
+        b.lept_pushback_array_element()->lept_set_number(2000 - i);
+    }
+    b.lept_pushback_array_element()->lept_set_number(-1.0);
+    lept_diff(&a, &b, &p);
+    EXPECT_EQ_SIZE_T(2000, p.lept_get_array_size());   /* a[1000] == b[1000] */
+    EXPECT_EQ_INT(LEPT_PATCH_OK, lept_apply_patch(&a, &p));
+    EXPECT_TRUE(a.lept_is_equal(&b));
+    a.lept_free();
+    b.lept_free();
+    p.lept_free();
+}
+
+static void test_access_array() {
+    lept_value a, e;
+    a.lept_set_array(0);
+    EXPECT_EQ_SIZE_T(0, a.lept_get_array_size());
+    for (int i = 0; i < 10; i++)
+        a.lept_pushback_array_element()->lept_set_number(i);
+    EXPECT_EQ_SIZE_T(10, a.lept_get_array_size());
+    EXPECT_TRUE(a.lept_get_array_capacity() >= 10);
+    a.lept_insert_array_element(0)->lept_set_string("x", 1);
+    EXPECT_EQ_SIZE_T(11, a.lept_get_array_size());
+    EXPECT_EQ_STRING("x", a.lept_get_array_element(0)->lept_get_string(), a.lept_get_array_element(0)->lept_get_string_length());
+    EXPECT_EQ_DOUBLE(0.0, a.lept_get_array_element(1)->lept_get_number());
+    a.lept_erase_array_element(0, 4);
+    EXPECT_EQ_SIZE_T(7, a.lept_get_array_size());
+    EXPECT_EQ_DOUBLE(3.0, a.lept_get_array_element(0)->lept_get_number());
+
+    e.lept_copy(&a);
+    EXPECT_TRUE(e.lept_is_equal(&a));
+    e.lept_erase_array_element(6, 1);
+    EXPECT_EQ_INT(0, e.lept_is_equal(&a));
+    e.lept_swap(&a);
+    EXPECT_EQ_SIZE_T(6, a.lept_get_array_size());
+    e.lept_move(&a);
+    EXPECT_EQ_INT(LEPT_NULL, a.lept_get_type());
+    EXPECT_EQ_SIZE_T(6, e.lept_get_array_size());
+    e.lept_free();
+}
+
+static void test_access_object() {
+    lept_value o, c;
+    o.lept_set_object(0);
+    EXPECT_EQ_SIZE_T(0, o.lept_get_object_size());
+    for (int i = 0; i < 10; i++) {
+        char key[2] = { (char)('a' + i), '\0' };
+        o.lept_set_object_value(key, 1)->lept_set_number(i);
+    }
+    EXPECT_EQ_SIZE_T(10, o.lept_get_object_size());
+    EXPECT_TRUE(o.lept_get_object_capacity() >= 10);
+    o.lept_set_object_value("a", 1)->lept_set_boolean(1);
+    EXPECT_EQ_SIZE_T(10, o.lept_get_object_size());
+    EXPECT_EQ_INT(LEPT_TRUE, o.lept_find_object_value("a", 1)->lept_get_type());
+    o.lept_remove_object_value(o.lept_find_object_index("b", 1));
+    EXPECT_EQ_SIZE_T(9, o.lept_get_object_size());
+    EXPECT_TRUE(o.lept_find_object_value("b", 1) == NULL);
+    EXPECT_EQ_DOUBLE(2.0, o.lept_find_object_value("c", 1)->lept_get_number());
+    c.lept_copy(&o);
+    EXPECT_TRUE(c.lept_is_equal(&o));
+    c.lept_free();
+    o.lept_free();
+}
+
+#define TEST_CBOR_DECODE(expect, cbor)\
+    do {\
+        lept_value v, e;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse_cbor(cbor, sizeof(cbor) - 1));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, e.lept_parse(expect));\
+        EXPECT_TRUE(v.lept_is_equal(&e));\
+        v.lept_free();\
+        e.lept_free();\
+    } while(0)
+
+#define TEST_CBOR_ENCODE(cbor, json)\
+    do {\
+        lept_value v;\
+        char* out;\
+        size_t length;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json));\
+        out = v.lept_stringify_cbor(&length);\
+        EXPECT_EQ_SIZE_T(sizeof(cbor) - 1, length);\
+        EXPECT_TRUE(memcmp(cbor, out, length) == 0);\
+        free(out);\
+        v.lept_free();\
+    } while(0)
+
+#define TEST_CBOR_ERROR(error, cbor)\
+    do {\
+        lept_value v;\
+        EXPECT_EQ_INT(error, v.lept_parse_cbor(cbor, sizeof(cbor) - 1));\
+        EXPECT_EQ_INT(LEPT_NULL, v.lept_get_type());\
+    } while(0)
+
+static void test_cbor_decode() {
+    /* examples from RFC 8949 appendix A */
+    TEST_CBOR_DECODE("0", "\x00");
+    TEST_CBOR_DECODE("23", "\x17");
+    TEST_CBOR_DECODE("24", "\x18\x18");
+    TEST_CBOR_DECODE("1000", "\x19\x03\xe8");
+    TEST_CBOR_DECODE("1000000000000", "\x1b\x00\x00\x00\xe8\xd4\xa5\x10\x00");
+    TEST_CBOR_DECODE("-1", "\x20");
+    TEST_CBOR_DECODE("-1000", "\x39\x03\xe7");
+    TEST_CBOR_DECODE("1.5", "\xf9\x3e\x00");
+    TEST_CBOR_DECODE("65504.0", "\xf9\x7b\xff");
+    TEST_CBOR_DECODE("5.960464477539063e-8", "\xf9\x00\x01");
+    TEST_CBOR_DECODE("-4", "\xf9\xc4\x00");
+    TEST_CBOR_DECODE("100000.0", "\xfa\x47\xc3\x50\x00");
+    TEST_CBOR_DECODE("1.1", "\xfb\x3f\xf1\x99\x99\x99\x99\x99\x9a");
+    TEST_CBOR_DECODE("false", "\xf4");
+    TEST_CBOR_DECODE("true", "\xf5");
+    TEST_CBOR_DECODE("null", "\xf6");
+    TEST_CBOR_DECODE("null", "\xf7");
+    TEST_CBOR_DECODE("\"\"", "\x60");
+    TEST_CBOR_DECODE("\"IETF\"", "\x64\x49\x45\x54\x46");
+    TEST_CBOR_DECODE("\"\\u00fc\"", "\x62\xc3\xbc");
+    TEST_CBOR_DECODE("[]", "\x80");
+    TEST_CBOR_DECODE("[1,[2,3],[4,5]]", "\x83\x01\x82\x02\x03\x82\x04\x05");
+    TEST_CBOR_DECODE("{}", "\xa0");
+    TEST_CBOR_DECODE("{\"a\":1,\"b\":[2,3]}", "\xa2\x61\x61\x01\x61\x62\x82\x02\x03");
+    TEST_CBOR_DECODE("1363896240", "\xc1\x1a\x51\x4b\x67\xb0");    /* tag 1, epoch time */
+}
+
+static void test_cbor_encode() {
+    TEST_CBOR_ENCODE("\x00", "0");
+    TEST_CBOR_ENCODE("\x17", "23");
+    TEST_CBOR_ENCODE("\x18\x64", "100");
+    TEST_CBOR_ENCODE("\x19\x03\xe8", "1000");
+    TEST_CBOR_ENCODE("\x1a\x00\x0f\x42\x40", "1000000");
+    TEST_CBOR_ENCODE("\x29", "-10");
+    TEST_CBOR_ENCODE("\x38\x63", "-100");
+    TEST_CBOR_ENCODE("\xfa\x3f\xc0\x00\x00", "1.5");
+    TEST_CBOR_ENCODE("\xfa\x80\x00\x00\x00", "-0.0");
+    TEST_CBOR_ENCODE("\xfb\x3f\xf1\x99\x99\x99\x99\x99\x9a", "1.1");
+    TEST_CBOR_ENCODE("\xfa\x7f\x7f\xff\xff", "3.4028234663852886e38");
+    TEST_CBOR_ENCODE("\xfb\x47\xef\xff\xff\xf0\x00\x00\x00", "3.4028235677973366e38");
+    TEST_CBOR_ENCODE("\xfb\x7e\x37\xe4\x3c\x88\x00\x75\x9c", "1e300");
+    TEST_CBOR_ENCODE("\xfb\xfe\x37\xe4\x3c\x88\x00\x75\x9c", "-1e300");
+    TEST_CBOR_ENCODE("\xf6", "null");
+    TEST_CBOR_ENCODE("\xf4", "false");
+    TEST_CBOR_ENCODE("\xf5", "true");
+    TEST_CBOR_ENCODE("\x64\x49\x45\x54\x46", "\"IETF\"");
+    TEST_CBOR_ENCODE("\x83\x01\x82\x02\x03\x82\x04\x05", "[1,[2,3],[4,5]]");
+    TEST_CBOR_ENCODE("\xa2\x61\x61\x01\x61\x62\x82\x02\x03", "{\"a\":1,\"b\":[2,3]}");
+}
+
+static void test_cbor_error() {
+    TEST_CBOR_ERROR(LEPT_PARSE_EXPECT_VALUE, "");
+    TEST_CBOR_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "\x01\x02");
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x18");             /* truncated argument */
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x1c");             /* reserved */
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x9f\x01\xff");     /* indefinite length */
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x43\x01\x02\x03"); /* byte string */
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x65\x49\x45");     /* truncated text */
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x9b\xff\xff\xff\xff\xff\xff\xff\xff\x01");
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\x83\x01\x02");   /* more elements than bytes */
+    TEST_CBOR_ERROR(LEPT_PARSE_MISS_KEY, "\xa1\x01\x02");
+    TEST_CBOR_ERROR(LEPT_PARSE_EXPECT_VALUE, "\xa2\x61\x61\x01\x61\x62");
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\xf8\x20");         /* simple value */
+    /* no JSON text holds nan or infinity */
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\xf9\x7e\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "\xf9\x7c\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "\xf9\xfc\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\xfa\x7f\xc0\x00\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "\xfa\x7f\x80\x00\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\xfb\x7f\xf8\x00\x00\x00\x00\x00\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "\xfb\x7f\xf0\x00\x00\x00\x00\x00\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "\xfb\xff\xf0\x00\x00\x00\x00\x00\x00");
+    TEST_CBOR_ERROR(LEPT_PARSE_INVALID_VALUE, "\xa1\x61\x61\x82\x01\xf9\x7e\x00");
+    {
+        lept_value v;
+        EXPECT_EQ_INT(LEPT_PARSE_INVALID_UTF8, v.lept_parse_cbor("\x62\xc0\xaf", 3, LEPT_PARSE_STRICT_UTF8));
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse_cbor("\x62\xc0\xaf", 3));
+        v.lept_free();
+    }
+}
+
+static void test_cbor_roundtrip() {
+    static const char* json[] = {
+        "null", "false", "true", "0", "-0", "1", "-1", "1.5", "-1.5", "3.25", "0.1",
+        "1e300", "-1e-300", "9007199254740992", "-9007199254740992", "9007199254740993e10", "4294967296",
+        "\"\"", "\"Hello\\nWorld\"", "\"\\u20ac\\ud834\\udd1e\"",
+        "[]", "[null,false,true,123,\"abc\",[1,2,3]]",
+        "{}", "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}"
+    };
+    for (size_t i = 0; i < sizeof(json) / sizeof(json[0]); i++) {
+        lept_value v, w;
+        size_t length;
+        EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json[i]));
+        char* cbor = v.lept_stringify_cbor(&length);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, w.lept_parse_cbor(cbor, length));
+        EXPECT_TRUE(v.lept_is_equal(&w));
+        if (v.lept_get_type() == LEPT_NUMBER)
+            EXPECT_TRUE(memcmp(&v.u.n, &w.u.n, sizeof(double)) == 0);  /* bit exact, including -0.0 */
+        w.lept_free();
+        EXPECT_EQ_INT(LEPT_PARSE_OK, w.lept_parse_cbor(cbor, length, LEPT_PARSE_ZERO_COPY));
+        EXPECT_TRUE(v.lept_is_equal(&w));
+        w.lept_free();
+        free(cbor);
+        v.lept_free();
+    }
+}
+
+static void test_cbor_zero_copy() {
+    static const char cbor[] = "\x82\x63\x61\x62\x63\xa1\x61\x6b\x62\x78\x79";  /* ["abc", {"k": "xy"}] */
+    lept_value v, c;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse_cbor(cbor, sizeof(cbor) - 1, LEPT_PARSE_ZERO_COPY));
+    EXPECT_TRUE(v.lept_get_array_element(0)->lept_get_string() == cbor + 2);
+    EXPECT_EQ_SIZE_T(3, v.lept_get_array_element(0)->lept_get_string_length());
+    EXPECT_TRUE(v.lept_get_array_element(1)->lept_find_object_value("k", 1)->lept_get_string() == cbor + 9);
+    c.lept_copy(&v);
+    EXPECT_TRUE(c.lept_get_array_element(0)->lept_get_string() != cbor + 2);
+    EXPECT_TRUE(c.lept_is_equal(&v));
+    v.lept_get_array_element(0)->lept_set_string("d", 1);
+    EXPECT_EQ_INT(0, c.lept_is_equal(&v));
+    c.lept_free();
+    v.lept_free();
+}
+
+struct bind_point {
+    double x, y;
+};
+
+struct bind_record {
+    int id;
+    unsigned char level;
+    bool active;
+    std::string name;
+    bind_point origin;
+    std::vector<bind_point> path;
+    std::vector<std::string> tags;
+    std::optional<long long> parent;
+};
+
+LEPT_BIND(bind_point, LEPT_FIELD(bind_point, x), LEPT_FIELD(bind_point, y))
+LEPT_BIND(bind_record,
+    LEPT_FIELD(bind_record, id), LEPT_FIELD(bind_record, level), LEPT_FIELD(bind_record, active),
+    lept_field("display name", &bind_record::name), LEPT_FIELD(bind_record, origin),
+    LEPT_FIELD(bind_record, path), LEPT_FIELD(bind_record, tags), LEPT_FIELD(bind_record, parent))
+
+static void test_bind_parse() {
+    bind_record r = bind_record();
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(
+        " { \"id\" : 42, \"level\": 7, \"active\": true, \"display name\": \"a\\tb\\u00e9\","
+        " \"unknown\": {\"a\": [1, {\"b\": null}], \"c\": \"}\"},"
+        " \"origin\": {\"y\": -2.5, \"x\": 1e3, \"z\": 0}, \"path\": [{\"x\": 1, \"y\": 2}, {}],"
+        " \"tags\": [\"p\", \"\"], \"parent\": 9007199254740991 } ", &r));
+    EXPECT_EQ_INT(42, r.id);
+    EXPECT_EQ_INT(7, r.level);
+    EXPECT_TRUE(r.active);
+    EXPECT_EQ_STRING("a\tb\xC3\xA9", r.name.data(), r.name.size());
+    EXPECT_EQ_DOUBLE(1000.0, r.origin.x);
+    EXPECT_EQ_DOUBLE(-2.5, r.origin.y);
+    EXPECT_EQ_SIZE_T(2, r.path.size());
+    EXPECT_EQ_DOUBLE(2.0, r.path[0].y);
+    EXPECT_EQ_SIZE_T(2, r.tags.size());
+    EXPECT_EQ_SIZE_T(0, r.tags[1].size());
+    EXPECT_TRUE(r.parent && *r.parent == 9007199254740991LL);
+
+    /* missing keys keep their value, null resets an optional */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"parent\":null,\"tags\":[]}", &r));
+    EXPECT_EQ_INT(42, r.id);
+    EXPECT_TRUE(!r.parent);
+    EXPECT_EQ_SIZE_T(0, r.tags.size());
+}
+
+static void test_bind_error() {
+    bind_record r = bind_record();
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("[]", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"id\":\"1\"}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"id\":1.5}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"id\":2147483648}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"id\":-2147483648}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"level\":256}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"level\":-1}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"active\":0}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"path\":[1]}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"display name\":null}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"name\":null}", &r)); /* not a bound key */
+    /* skipped strings are only checked as UTF-8 when asked to, like lept_parse */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"name\":\"\xff\",\"id\":1}", &r));
+    EXPECT_EQ_INT(1, r.id);
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UTF8, lept_bind_parse("{\"name\":\"\xff\",\"id\":1}", &r, LEPT_PARSE_STRICT_UTF8));
+
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_bind_parse("", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_bind_parse("{\"id\":", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_bind_parse("{\"active\":tru}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_bind_parse("{\"origin\":{\"x\":01}}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_bind_parse("{\"x\":nul}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_KEY, lept_bind_parse("{1:2}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_bind_parse("{\"id\" 1}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_bind_parse("{\"id\":1 \"level\":2}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_bind_parse("{\"tags\":[\"a\" \"b\"]}", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_bind_parse("{\"display name\":\"abc", &r));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_bind_parse("{} x", &r));
+}
+
+static void test_bind_stringify() {
+    bind_record r = bind_record(), r2 = bind_record();
+    std::string json;
+    r.id = -3;
+    r.level = 200;
+    r.active = true;
+    r.name = "q\"\\\x01/";
+    r.origin.x = 0.1;
+    r.origin.y = -1e300;
+    r.path.resize(2);
+    r.path[1].x = 3;
+    r.tags.push_back("\xE2\x82\xAC");
+    lept_bind_stringify(r, &json);
+    EXPECT_EQ_STRING("{\"id\":-3,\"level\":200,\"active\":true,\"display name\":\"q\\\"\\\\\\u0001/\","
+        "\"origin\":{\"x\":0.10000000000000001,\"y\":-1.0000000000000001e+300},"
+        "\"path\":[{\"x\":0,\"y\":0},{\"x\":3,\"y\":0}],\"tags\":[\"\xE2\x82\xAC\"],\"parent\":null}",
+        json.data(), json.size());
+
+    /* stringify then parse restores every field */
+    r.parent = -1;
+    json.clear();
+    lept_bind_stringify(r, &json);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(json.c_str(), &r2));
+    EXPECT_EQ_INT(r.id, r2.id);
+    EXPECT_EQ_INT(r.level, r2.level);
+    EXPECT_TRUE(r.name == r2.name);
+    EXPECT_EQ_DOUBLE(r.origin.x, r2.origin.x);
+    EXPECT_EQ_DOUBLE(r.origin.y, r2.origin.y);
+    EXPECT_EQ_DOUBLE(r.path[1].x, r2.path[1].x);
+    EXPECT_TRUE(r.tags == r2.tags);
+    EXPECT_TRUE(r2.parent && *r2.parent == -1);
+
+    /* the same text parses into a lept_value */
+    lept_value v;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json.c_str()));
+    EXPECT_EQ_SIZE_T(8, v.lept_get_object_size());
+    v.lept_free();
+}
+
+/* 128 fields, far more than any hand-written struct */
+#define BIND_WIDE_FIELDS(p) int p##0, p##1, p##2, p##3, p##4, p##5, p##6, p##7;
+#define BIND_WIDE_BIND(p) LEPT_FIELD(bind_wide, p##0), LEPT_FIELD(bind_wide, p##1), LEPT_FIELD(bind_wide, p##2),\
+    LEPT_FIELD(bind_wide, p##3), LEPT_FIELD(bind_wide, p##4), LEPT_FIELD(bind_wide, p##5),\
+    LEPT_FIELD(bind_wide, p##6), LEPT_FIELD(bind_wide, p##7)
+
+struct bind_wide {
+    BIND_WIDE_FIELDS(a) BIND_WIDE_FIELDS(b) BIND_WIDE_FIELDS(c) BIND_WIDE_FIELDS(d)
+    BIND_WIDE_FIELDS(e) BIND_WIDE_FIELDS(f) BIND_WIDE_FIELDS(g) BIND_WIDE_FIELDS(h)
+    BIND_WIDE_FIELDS(i) BIND_WIDE_FIELDS(j) BIND_WIDE_FIELDS(k) BIND_WIDE_FIELDS(l)
+    BIND_WIDE_FIELDS(m) BIND_WIDE_FIELDS(n) BIND_WIDE_FIELDS(o) BIND_WIDE_FIELDS(p)
+};
+
+LEPT_BIND(bind_wide,
+    BIND_WIDE_BIND(a), BIND_WIDE_BIND(b), BIND_WIDE_BIND(c), BIND_WIDE_BIND(d),
+    BIND_WIDE_BIND(e), BIND_WIDE_BIND(f), BIND_WIDE_BIND(g), BIND_WIDE_BIND(h),
+    BIND_WIDE_BIND(i), BIND_WIDE_BIND(j), BIND_WIDE_BIND(k), BIND_WIDE_BIND(l),
+    BIND_WIDE_BIND(m), BIND_WIDE_BIND(n), BIND_WIDE_BIND(o), BIND_WIDE_BIND(p))
+
+static void test_bind_wide() {
+    bind_wide w = bind_wide(), w2 = bind_wide();
+    std::string json;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"a0\":1,\"p7\":2,\"h3\":3,\"q0\":4,\"a\":5,\"a00\":6}", &w));
+    EXPECT_EQ_INT(1, w.a0);
+    EXPECT_EQ_INT(2, w.p7);
+    EXPECT_EQ_INT(3, w.h3);
+    EXPECT_EQ_INT(0, w.a1);
+
+    /* every key finds its own field */
+    lept_bind_stringify(w, &json);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(json.c_str(), &w2));
+    EXPECT_TRUE(memcmp(&w, &w2, sizeof(w)) == 0);
+    lept_value v;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json.c_str()));
+    EXPECT_EQ_SIZE_T(128, v.lept_get_object_size());
+    for (size_t i = 0; i < v.lept_get_object_size(); i++) {
+        const char* k = v.lept_get_object_key(i);
+        EXPECT_EQ_INT((int)i, lept_bind_map<bind_wide>::find(k, v.lept_get_object_key_length(i)));
+    }
+    v.lept_free();
+}
+
+struct bind_number {
+    long long i;
+    unsigned long long u;
+    float f;
+    double d;
+};
+
+LEPT_BIND(bind_number, LEPT_FIELD(bind_number, i), LEPT_FIELD(bind_number, u),
+    LEPT_FIELD(bind_number, f), LEPT_FIELD(bind_number, d))
+
+#define TEST_BIND_INTEGER(expect, json)\
+    do {\
+        bind_number b = bind_number();\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(json, &b));\
+        EXPECT_TRUE(b.i == (expect));\
+    } while(0)
+
+#define TEST_BIND_UNSIGNED(expect, json)\
+    do {\
+        bind_number b = bind_number();\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(json, &b));\
+        EXPECT_TRUE(b.u == (expect));\
+    } while(0)
+
+static void test_bind_number() {
+    bind_number b = bind_number(), b2 = bind_number();
+    std::string json;
+
+    /* integers beyond 2^53 are converted from their text */
+    TEST_BIND_INTEGER(9007199254740993LL, "{\"i\":9007199254740993}");
+    TEST_BIND_INTEGER(-9007199254740993LL, "{\"i\":-9007199254740993}");
+    TEST_BIND_INTEGER(9223372036854775807LL, "{\"i\":9223372036854775807}");
+    TEST_BIND_INTEGER(-9223372036854775807LL - 1, "{\"i\":-9223372036854775808}");
+    TEST_BIND_INTEGER(1500, "{\"i\":1.5e3}");
+    TEST_BIND_INTEGER(0, "{\"i\":-0}");
+    TEST_BIND_UNSIGNED(9007199254740993ULL, "{\"u\":9007199254740993}");
+    TEST_BIND_UNSIGNED(18446744073709551615ULL, "{\"u\":18446744073709551615}");
+    TEST_BIND_UNSIGNED(0, "{\"u\":-0}");
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"i\":9223372036854775808}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"i\":-9223372036854775809}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"i\":100000000000000000000000000000000}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"u\":18446744073709551616}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"u\":-1}", &b));
+    /* with a fraction or exponent, only where the double is exact */
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"i\":9007199254740993.0}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"u\":1e19}", &b));
+
+    /* floating point fields must hold the value, null stands for non-finite values */
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_bind_parse("{\"f\":1e300}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_bind_parse("{\"f\":-3.5e38}", &b));
+    /* 2^128 - 2^103 is FLT_MAX plus half an ulp, the first value that narrows to infinity */
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_bind_parse("{\"f\":3.4028235677973366e38}", &b));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"f\":3.4028235677973362e38}", &b));
+    EXPECT_TRUE(b.f == FLT_MAX);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"f\":3.4028235e38}", &b));
+    EXPECT_TRUE(b.f == FLT_MAX);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"f\":-3.4028235e38}", &b));
+    EXPECT_TRUE(b.f == -FLT_MAX);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"f\":3.4028234663852886e+38,\"d\":1e300}", &b));
+    EXPECT_TRUE(b.f == FLT_MAX);
+    EXPECT_EQ_DOUBLE(1e300, b.d);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse("{\"f\":null,\"d\":null}", &b));
+    EXPECT_TRUE(b.f != b.f && b.d != b.d);
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_bind_parse("{\"i\":null}", &b));
+
+    /* stringify then parse restores the extremes */
+    b.i = -9223372036854775807LL - 1;
+    b.u = 18446744073709551615ULL;
+    b.f = HUGE_VALF;
+    b.d = 0.1;
+    lept_bind_stringify(b, &json);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(json.c_str(), &b2));
+    EXPECT_TRUE(b2.i == b.i && b2.u == b.u);
+    EXPECT_TRUE(b2.f != b2.f);
+    EXPECT_EQ_DOUBLE(b.d, b2.d);
+    b.i = 9223372036854775807LL;
+    json.clear();
+    lept_bind_stringify(b, &json);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_bind_parse(json.c_str(), &b2));
+    EXPECT_TRUE(b2.i == b.i);
+}
+
+static void test_image() {
+    lept_value v, v2;
+    lept_image image;
+    size_t length;
+    const char* json = "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"d\":-1.5e-300,\"s\":\"abc\\u0000def\","
+        "\"e\":\"\",\"a\":[1,[],{},[\"x\",\"yz\"]],\"o\":{\"k\":{\"\":0}}}";
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse(json));
+    char* data = v.lept_stringify_image(&length);
+    EXPECT_EQ_INT(LEPT_IMAGE_OK, image.lept_load(data, length));
+    const lept_image_value* root = image.lept_get_root();
+    EXPECT_EQ_INT(LEPT_OBJECT, root->lept_get_type());
+    EXPECT_EQ_SIZE_T(9, root->lept_get_object_size());
+    EXPECT_EQ_STRING("n", root->lept_get_object_key(0), root->lept_get_object_key_length(0));
+    EXPECT_EQ_INT(LEPT_NULL, root->lept_get_object_value(0)->lept_get_type());
+    EXPECT_EQ_INT(0, root->lept_find_object_value("f", 1)->lept_get_boolean());
+    EXPECT_EQ_INT(1, root->lept_find_object_value("t", 1)->lept_get_boolean());
+    EXPECT_EQ_DOUBLE(123.0, root->lept_find_object_value("i", 1)->lept_get_number());
+    EXPECT_EQ_DOUBLE(-1.5e-300, root->lept_find_object_value("d", 1)->lept_get_number());
+    const lept_image_value* s = root->lept_find_object_value("s", 1);
+    EXPECT_EQ_STRING("abc\0def", s->lept_get_string(), s->lept_get_string_length());
+    EXPECT_EQ_INT('\0', s->lept_get_string()[s->lept_get_string_length()]);
+    EXPECT_EQ_SIZE_T(0, root->lept_find_object_value("e", 1)->lept_get_string_length());
+    const lept_image_value* a = root->lept_find_object_value("a", 1);
+    EXPECT_EQ_SIZE_T(4, a->lept_get_array_size());
+    EXPECT_EQ_SIZE_T(0, a->lept_get_array_element(1)->lept_get_array_size());
+    EXPECT_EQ_SIZE_T(0, a->lept_get_array_element(2)->lept_get_object_size());
+    EXPECT_EQ_STRING("yz", a->lept_get_array_element(3)->lept_get_array_element(1)->lept_get_string(), 2);
+    const lept_image_value* k = root->lept_find_object_value("o", 1)->lept_find_object_value("k", 1);
+    EXPECT_EQ_DOUBLE(0.0, k->lept_find_object_value("", 0)->lept_get_number());
+    EXPECT_TRUE(root->lept_find_object_value("x", 1) == NULL);
+    EXPECT_EQ_SIZE_T(LEPT_KEY_NOT_EXIST, root->lept_find_object_index("nn", 2));
+
+    /* offsets are relative, a moved copy reads the same */
+    char* moved = (char*)malloc(length);
+    memcpy(moved, data, length);
+    free(data);
+    EXPECT_EQ_INT(LEPT_IMAGE_OK, image.lept_load(moved, length));
+    image.lept_get_root()->lept_to_value(&v2);
+    EXPECT_TRUE(v.lept_is_equal(&v2));
+    image.lept_close();
+    v2.lept_free();
+
+    /* through a file */
+    char path[] = "/tmp/leptjson_image_XXXXXX";
+    FILE* fp = NULL;
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        fp = fdopen(fd, "wb");
+#endif
+    if (fp != NULL) {
+        EXPECT_EQ_SIZE_T(length, fwrite(moved, 1, length, fp));
+        fclose(fp);
+        EXPECT_EQ_INT(LEPT_IMAGE_OK, image.lept_open(path));
+        image.lept_get_root()->lept_to_value(&v2);
+        EXPECT_TRUE(v.lept_is_equal(&v2));
+        v2.lept_free();
+        image.lept_close();
+        remove(path);
+    }
+    EXPECT_EQ_INT(LEPT_IMAGE_IO_ERROR, image.lept_open("/nonexistent/leptjson.img"));
+
+    /* only the header is checked */
+    EXPECT_EQ_INT(LEPT_IMAGE_INVALID_FORMAT, image.lept_load(moved, length - 8));
+    EXPECT_EQ_INT(LEPT_IMAGE_INVALID_FORMAT, image.lept_load(moved, 16));
+    EXPECT_EQ_INT(LEPT_IMAGE_INVALID_FORMAT, image.lept_load(NULL, 0));
+    moved[0] = 'X';
+    EXPECT_EQ_INT(LEPT_IMAGE_INVALID_FORMAT, image.lept_load(moved, length));
+    free(moved);
+    v.lept_free();
+
+    /* scalar roots */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, v.lept_parse("\"root\""));
+    data = v.lept_stringify_image(&length);
+    EXPECT_EQ_INT(LEPT_IMAGE_OK, image.lept_load(data, length));
+    EXPECT_EQ_STRING("root", image.lept_get_root()->lept_get_string(), image.lept_get_root()->lept_get_string_length());
+    image.lept_close();
+    free(data);
+    v.lept_free();
+}
+
+/* feed json in chunks of every size up to 7 bytes, the result must match lept_parse() */
+#define TEST_STREAM(json, flags)\
+    do {\
+        lept_value expect, actual;\
+        int ret = expect.lept_parse(json, flags);\
+        size_t len = strlen(json);\
+        for (size_t chunk = 1; chunk <= 7; chunk++) {\
+            lept_stream_parser p(&actual, flags);\
+            int r = LEPT_PARSE_INCOMPLETE;\
+            for (size_t i = 0; i < len && r == LEPT_PARSE_INCOMPLETE; i += chunk)\
+                r = p.lept_feed(json + i, len - i < chunk ? len - i : chunk);\
+            if (r == LEPT_PARSE_INCOMPLETE)\
+                r = p.lept_finish();\
+            EXPECT_EQ_INT(ret, r);\
+            if (ret == LEPT_PARSE_OK)\
+                EXPECT_TRUE(expect.lept_is_equal(&actual));\
+            else\
+                EXPECT_EQ_INT(LEPT_NULL, actual.lept_get_type());\
+            actual.lept_free();\
+        }\
+        expect.lept_free();\
+    } while(0)
+
+static void test_parse_stream() {
+    lept_value v;
+
+    TEST_STREAM(" [ null , false , true , -1.25e+10 , \"a\\nb\\u00e9\", [], {}, [[1], {\"\": [2]}] ] ", 0);
+    TEST_STREAM("{\"n\":null,\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2},\"s\":\"x\"}", 0);
+    TEST_STREAM("\"\xE2\x82\xAC\\uD834\\uDD1E\"", LEPT_PARSE_STRICT_UTF8);
+    TEST_STREAM("", 0);
+    TEST_STREAM("[1,]", 0);
+    TEST_STREAM("[1", 0);
+    TEST_STREAM("0123", 0);
+    TEST_STREAM("1e309", 0);
+    TEST_STREAM("\"ab\\", 0);
+    TEST_STREAM("\"\xC0\x80\"", LEPT_PARSE_STRICT_UTF8);
+    TEST_STREAM("{\"a\":1 \"b\":2}", 0);
+    TEST_STREAM("{} []", 0);
+
+    /* one byte at a time */
+    lept_stream_parser* p = new lept_stream_parser(&v);
+    const char* json = "{\"a\":[true,\"b\"]}";
+    for (size_t i = 0; json[i]; i++)
+        EXPECT_EQ_INT(LEPT_PARSE_INCOMPLETE, p->lept_feed(json + i, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, p->lept_finish());
+    EXPECT_EQ_INT(LEPT_PARSE_OK, p->lept_finish());
+    delete p;
+    EXPECT_EQ_SIZE_T(2, v.lept_find_object_value("a", 1)->lept_get_array_size());
+    v.lept_free();
+
+    /* abandoned before the end, nothing is left behind */
+    p = new lept_stream_parser(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_INCOMPLETE, p->lept_feed("[1, [\"x\", {\"k\": \"", 17));
+    delete p;
+    EXPECT_EQ_INT(LEPT_NULL, v.lept_get_type());
 }
 
 int main() {
     test_parse();
+    test_equal();
+    test_equal_large_object();
+    test_hash();
+    test_access_array();
+    test_access_object();
+    test_apply_patch();
+    test_diff();
+    test_diff_large_array();
+    test_cbor_decode();
+    test_cbor_encode();
+    test_cbor_error();
+    test_cbor_roundtrip();
+    test_cbor_zero_copy();
+    test_bind_parse();
+    test_bind_error();
+    test_bind_stringify();
+    test_bind_number();
+    test_bind_wide();
+    test_image();
+    test_parse_stream();
     printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "leptjson.h"
+#include "leptjson_async.h"
+
+using namespace leptjson;
+
+static int main_ret = 0;
+static int test_count = 0;
+static int test_pass = 0;
+
+#define EXPECT_EQ_BASE(equality, expect, actual, format) \
+    do {\
+        test_count++;\
+        if (equality)\
+            test_pass++;\
+        else {\
+            fprintf(stderr, "%s:%d: expect: " format " actual: " format "\n", __FILE__, __LINE__, expect, actual);\
+            main_ret = 1;\
+        }\
+    } while(0)
+
+#define EXPECT_EQ_INT(expect, actual) EXPECT_EQ_BASE((expect) == (actual), expect, actual, "%d")
+#define EXPECT_EQ_STRING(expect, actual, alength) \
+    EXPECT_EQ_BASE(sizeof(expect) - 1 == alength && memcmp(expect, actual, alength) == 0, expect, actual, "%s")
+#define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual) != 0, "true", "false", "%s")
+
+/* delivers its input in pseudo-random chunks, suspending the reader on every read */
+struct mock_source {
+    const char* data;
+    size_t len, pos;
+    unsigned seed;
+    size_t max_chunk;
+    std::coroutine_handle<> pending;
+
+    struct read_awaiter {
+        mock_source* src;
+        char* buf;
+        size_t size;
+
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h) { src->pending = h; }
+        size_t await_resume() {
+            src->seed = src->seed * 1103515245u + 12345u;
+            size_t n = 1 + (src->seed >> 16) % src->max_chunk;
+            if (n > size)
+                n = size;
+            if (n > src->len - src->pos)
+                n = src->len - src->pos;
+            memcpy(buf, src->data + src->pos, n);
+            src->pos += n;
+            return n;
+        }
+    };
+    read_awaiter read(char* buf, size_t size) { return read_awaiter{ this, buf, size }; }
+};
+
+/* the event loop: resume whatever waits on the source until the task is done */
+static int run_async(lept_task<int>& task, mock_source& src) {
+    task.lept_start();
+    while (!task.lept_done()) {
+        std::coroutine_handle<> h = src.pending;
+        src.pending = nullptr;
+        h.resume();
+    }
+    return task.lept_result();
+}
+
+#define TEST_ASYNC(json, flags)\
+    do {\
+        lept_value expect, actual;\
+        int ret = expect.lept_parse(json, flags);\
+        for (unsigned seed = 1; seed <= 8; seed++) {\
+            mock_source src = { json, strlen(json), 0, seed, seed * 3, nullptr };\
+            lept_task<int> task = lept_parse_async(src, &actual, flags);\
+            EXPECT_EQ_INT(ret, run_async(task, src));\
+            if (ret == LEPT_PARSE_OK)\
+                EXPECT_TRUE(expect.lept_is_equal(&actual));\
+            else\
+                EXPECT_EQ_INT(LEPT_NULL, actual.lept_get_type());\
+            actual.lept_free();\
+        }\
+        expect.lept_free();\
+    } while(0)
+
+static void test_parse_async() {
+    TEST_ASYNC("null", 0);
+    TEST_ASYNC(" true ", 0);
+    TEST_ASYNC("-1.25e+10", 0);
+    TEST_ASYNC("\"Hello\\nWorld \\\" \\\\ \\u00e9\\uD834\\uDD1E \xE2\x82\xAC\"", LEPT_PARSE_STRICT_UTF8);
+    TEST_ASYNC("[ null , false , true , 123 , \"abc\", [], {}, [[1], {\"\": [2]}] ]", 0);
+    TEST_ASYNC(" { \"n\" : null , \"a\" : [ 1, 2, 3 ], \"o\" : { \"1\" : 1, \"2\" : 2 }, \"s\": \"x\" } ", 0);
+
+    TEST_ASYNC("", 0);
+    TEST_ASYNC(" ", 0);
+    TEST_ASYNC("nul", 0);
+    TEST_ASYNC("truex", 0);
+    TEST_ASYNC("[1,]", 0);
+    TEST_ASYNC("[1", 0);
+    TEST_ASYNC("[1 2]", 0);
+    TEST_ASYNC("0123", 0);
+    TEST_ASYNC("1e309", 0);
+    TEST_ASYNC("\"abc", 0);
+    TEST_ASYNC("\"ab\\", 0);
+    TEST_ASYNC("\"\\v\"", 0);
+    TEST_ASYNC("\"\\uD800\"", 0);
+    TEST_ASYNC("\"\\u12\"", 0);
+    TEST_ASYNC("\"\xC0\x80\"", LEPT_PARSE_STRICT_UTF8);
+    TEST_ASYNC("{1:1}", 0);
+    TEST_ASYNC("{\"a\" 1}", 0);
+    TEST_ASYNC("{\"a\":1 \"b\":2}", 0);
+    TEST_ASYNC("{\"a\":{\"b\":[1, {\"c\":", 0);
+    TEST_ASYNC("{} []", 0);
+
+    /* a string much longer than any chunk */
+    std::string big = "[\"";
+    for (int i = 0; i < 5000; i++)
+        big += i % 100 == 0 ? "\\\"" : "x";
+    big += "\", 1]";
+    TEST_ASYNC(big.c_str(), 0);
+}
+
+static lept_task<int> parse_two_async(mock_source& a, mock_source& b, lept_value* v) {
+    int ret = co_await lept_parse_async(a, v);
+    if (ret != LEPT_PARSE_OK)
+        co_return ret;
+    v->lept_free();
+    co_return co_await lept_parse_async(b, v);
+}
+
+static void test_parse_async_nested() {
+    lept_value v;
+    mock_source a = { "[1, 2]", 6, 0, 7, 2, nullptr };
+    mock_source b = { "{\"k\": \"v\"}", 10, 0, 9, 3, nullptr };
+    lept_task<int> task = parse_two_async(a, b, &v);
+    task.lept_start();
+    while (!task.lept_done()) {
+        mock_source& src = a.pending ? a : b;
+        std::coroutine_handle<> h = src.pending;
+        src.pending = nullptr;
+        h.resume();
+    }
+    EXPECT_EQ_INT(LEPT_PARSE_OK, task.lept_result());
+    EXPECT_EQ_STRING("v", v.lept_find_object_value("k", 1)->lept_get_string(), 1);
+    v.lept_free();
+}
+
+int main() {
+    test_parse_async();
+    test_parse_async_nested();
+    printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
+    return main_ret;
+}